@@ -43,6 +43,100 @@ HookReturnCode MainFunc( const string& in szString )
 	return HOOK_CONTINUE;
 }
 
+HookReturnCode TypedFunc( const string& in szString, int iValue )
+{
+	Print( "typed hook called: " + szString + " " + iValue + "\n" );
+
+	return HOOK_CONTINUE;
+}
+
+class FilterTarget
+{
+	~FilterTarget()
+	{
+		Print( "Filter target destroyed\n" );
+	}
+}
+
+FilterTarget@ g_pFilterTarget = FilterTarget();
+
+HookReturnCode FilteredTypedFunc( const string& in szString, int iValue )
+{
+	Print( "filtered hook called: " + szString + " " + iValue + "\n" );
+
+	return HOOK_CONTINUE;
+}
+
+void ReleaseFilterTarget()
+{
+	//The hook keeps the target alive, so its address can't be reused by another object.
+	@g_pFilterTarget = null;
+	
+	Print( "Released filter target\n" );
+}
+
+void BudgetedFunc( int iValue )
+{
+	Print( "budgeted function called: " + iValue + "\n" );
+}
+
+void ScheduleBudgeted()
+{
+	for( int iValue = 1; iValue <= 6; ++iValue )
+	{
+		Scheduler.SetTimeout( "BudgetedFunc", iValue, iValue );
+	}
+	
+	//Not due yet when the test thinks.
+	Scheduler.SetTimeout( "BudgetedFunc", 100, 100 );
+}
+
+class ScheduledDelegate
+{
+	void Method( int iValue )
+	{
+		Print( "delegate called: " + iValue + "\n" );
+	}
+}
+
+funcdef void ScheduledIntFunc( int );
+
+void ScheduleHandles()
+{
+	Scheduler.SetTimeout( @NoArgs, 1 );
+	
+	ScheduledIntFunc@ pFunc = @BudgetedFunc;
+	
+	Scheduler.SetTimeout( @pFunc, 1, 7 );
+	
+	//The delegate keeps the object alive until it has been called.
+	Scheduler.SetTimeout( @ScheduledIntFunc( ScheduledDelegate().Method ), 1, 8 );
+	
+	//These are checked when they are scheduled, since any type can be passed.
+	Print( "Non-function rejected: " + ( Scheduler.SetTimeout( 5, 1 ) is null ? "yes" : "no" ) + "\n" );
+	Print( "Mismatched arguments rejected: " + ( Scheduler.SetTimeout( @pFunc, 1, "text" ) is null ? "yes" : "no" ) + "\n" );
+	Print( "Missing arguments rejected: " + ( Scheduler.SetTimeout( @pFunc, 1 ) is null ? "yes" : "no" ) + "\n" );
+	
+	ScheduledIntFunc@ pNull;
+	
+	Print( "Null handle rejected: " + ( Scheduler.SetTimeout( @pNull, 1, 9 ) is null ? "yes" : "no" ) + "\n" );
+}
+
+void StoppedFunc()
+{
+	Print( "stopped function called\n" );
+}
+
+void StopTimer()
+{
+	CScheduledFunction@ pTimer = Scheduler.SetInterval( "StoppedFunc", 1, 5 );
+	
+	//Timers that won't be called anymore are removed right away.
+	pTimer.SetRepeatCount( 0 );
+	
+	Print( "Stopped timer removed: " + ( pTimer.HasBeenRemoved() ? "yes" : "no" ) + "\n" );
+}
+
 void Func( const string& in szString )
 {
 	Print( szString + "\n" );
@@ -136,6 +230,19 @@ int main( const string& in szString, const bool bInEvent )
 		Events::Main.Hook( @MainHook( Foo().Func ) );
 		
 		g_EventManager.HookEvent( "Main", @MainHook( HookEvent().Hook ) );
+		
+		Events::Typed.Hook( TypedFunc );
+		
+		TypedHook@ pFilteredHook = @FilteredTypedFunc;
+		
+		//Objects must be passed as handles, otherwise the hook could be filtered by a copy.
+		Print( "Filter without handle rejected: " + ( !Events::Typed.HookFilteredByObject( pFilteredHook, g_pFilterTarget ) ? "yes" : "no" ) + "\n" );
+		
+		Events::Typed.HookFilteredByObject( pFilteredHook, @g_pFilterTarget );
+		
+		//A function can be hooked with more than one key.
+		Events::Typed.HookFiltered( pFilteredHook, 1 );
+		Events::Typed.HookFiltered( pFilteredHook, 2 );
 	}
 	
 	CEvent@ pEvent = g_EventManager.FindEventByName( "Main" );
@@ -0,0 +1,119 @@
+#include <cassert>
+#include <chrono>
+
+#include "add_on/scriptbuilder.h"
+
+#include "util/ASLogging.h"
+
+#include "CASAsyncModuleBuild.h"
+
+CASAsyncModuleBuild::CASAsyncModuleBuild( CASModuleManager& manager, const CASModuleDescriptor& descriptor, const char* const pszModuleName, const char* const pszScriptModuleName,
+										  IASModuleBuilder& builder, IASModuleUserData* pUserData, const bool bReplaceExisting )
+	: m_Manager( manager )
+	, m_Descriptor( descriptor )
+	, m_szModuleName( pszModuleName )
+	, m_szScriptModuleName( pszScriptModuleName )
+	, m_Builder( builder )
+	, m_pUserData( pUserData )
+	, m_bReplaceExisting( bReplaceExisting )
+	, m_ScriptBuilder( std::make_unique<CScriptBuilder>() )
+{
+	m_Result = std::async( std::launch::async, [ this ]()
+	{
+		const auto result = m_Manager.CompileModule( m_Descriptor, m_szModuleName.c_str(), m_szScriptModuleName.c_str(), m_Builder, *m_ScriptBuilder, m_Dependencies, m_Stats );
+
+		--m_Manager.m_uiRunningAsyncBuilds;
+
+		return result;
+	} );
+}
+
+CASAsyncModuleBuild::~CASAsyncModuleBuild()
+{
+	if( m_bFinished )
+		return;
+
+	if( m_Result.get() != CASModuleManager::CompileResult::ABORTED )
+		m_ScriptBuilder->GetModule()->Discard();
+
+	if( m_pUserData )
+		m_pUserData->Release();
+}
+
+bool CASAsyncModuleBuild::IsReady() const
+{
+	return m_bFinished || m_Result.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+}
+
+void CASAsyncModuleBuild::Wait() const
+{
+	if( !m_bFinished )
+		m_Result.wait();
+}
+
+CASModule* CASAsyncModuleBuild::Finish()
+{
+	assert( !m_bFinished );
+
+	if( m_bFinished )
+		return nullptr;
+
+	m_bFinished = true;
+
+	auto pUserData = m_pUserData;
+
+	m_pUserData = nullptr;
+
+	const auto result = m_Result.get();
+
+	if( result == CASModuleManager::CompileResult::ABORTED )
+	{
+		m_Manager.RecordBuildStats( m_Stats );
+
+		if( pUserData )
+			pUserData->Release();
+
+		return nullptr;
+	}
+
+	const bool bSuccess = result == CASModuleManager::CompileResult::SUCCESS;
+
+	auto pExisting = bSuccess ? m_Manager.FindModuleByName( m_szModuleName.c_str() ) : nullptr;
+
+	if( pExisting && !m_bReplaceExisting )
+	{
+		as::Critical( "CASAsyncModuleBuild::Finish: A module named \"%s\" already exists\n", m_szModuleName.c_str() );
+
+		m_Manager.RecordBuildStats( m_Stats );
+
+		m_ScriptBuilder->GetModule()->Discard();
+
+		if( pUserData )
+			pUserData->Release();
+
+		return nullptr;
+	}
+
+	//Swap the names so the new module gets its final name. The existing module stays functional until the new one has been accepted.
+	if( pExisting )
+		m_Manager.RenameModule( *pExisting, ( m_szModuleName + "$replacing" ).c_str() );
+
+	m_ScriptBuilder->GetModule()->SetName( m_szModuleName.c_str() );
+
+	auto pModule = m_Manager.FinishBuild( m_Descriptor, *m_ScriptBuilder, &m_Builder, bSuccess, pUserData, m_Stats );
+
+	if( !pModule )
+	{
+		if( pExisting )
+			m_Manager.RenameModule( *pExisting, m_szModuleName.c_str() );
+
+		return nullptr;
+	}
+
+	pModule->SetDependencies( std::move( m_Dependencies ) );
+
+	if( pExisting )
+		m_Manager.RemoveModule( pExisting );
+
+	return pModule;
+}
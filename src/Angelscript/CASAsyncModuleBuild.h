@@ -0,0 +1,113 @@
+#ifndef ANGELSCRIPT_CASASYNCMODULEBUILD_H
+#define ANGELSCRIPT_CASASYNCMODULEBUILD_H
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CASModule.h"
+#include "CASModuleManager.h"
+
+class CScriptBuilder;
+
+/**
+*	@addtogroup ASModule
+*
+*	@{
+*/
+
+/**
+*	Handle to a module that is being built on a worker thread.
+*	The module is compiled in the background, then added to the manager when Finish is called.
+*	If the handle is destroyed before Finish is called, it waits for the build to complete and discards the module.
+*	The manager must outlive the handle.
+*	@see CASModuleManager::BuildModuleAsync
+*/
+class CASAsyncModuleBuild final
+{
+public:
+	/**
+	*	Constructor. Starts the build. Use CASModuleManager::BuildModuleAsync instead.
+	*/
+	CASAsyncModuleBuild( CASModuleManager& manager, const CASModuleDescriptor& descriptor, const char* const pszModuleName, const char* const pszScriptModuleName,
+						 IASModuleBuilder& builder, IASModuleUserData* pUserData, const bool bReplaceExisting );
+
+	/**
+	*	Destructor.
+	*/
+	~CASAsyncModuleBuild();
+
+	/**
+	*	@return The descriptor of the module.
+	*/
+	const CASModuleDescriptor& GetDescriptor() const { return m_Descriptor; }
+
+	/**
+	*	@return The name of the module.
+	*/
+	const char* GetModuleName() const { return m_szModuleName.c_str(); }
+
+	/**
+	*	@return Whether an existing module with the same name is replaced.
+	*/
+	bool ReplacesExisting() const { return m_bReplaceExisting; }
+
+	/**
+	*	@return Statistics about the build. Complete once Finish has been called.
+	*/
+	const CASModuleBuildStats& GetStats() const { return m_Stats; }
+
+	/**
+	*	@return Whether the worker thread is done. Finish will not block if this is true.
+	*/
+	bool IsReady() const;
+
+	/**
+	*	@return Whether Finish has been called.
+	*/
+	bool IsFinished() const { return m_bFinished; }
+
+	/**
+	*	Blocks until the worker thread is done.
+	*/
+	void Wait() const;
+
+	/**
+	*	Finishes the build. Waits for the worker thread if it isn't done yet.
+	*	Calls the builder's PostBuild method, adds the module to the manager and replaces the existing module if requested.
+	*	Must be called on the thread that uses the manager, and only once.
+	*	@return On success, the module. Otherwise, null.
+	*/
+	CASModule* Finish();
+
+private:
+	CASModuleManager& m_Manager;
+	const CASModuleDescriptor& m_Descriptor;
+
+	const std::string m_szModuleName;
+	const std::string m_szScriptModuleName;
+
+	IASModuleBuilder& m_Builder;
+	IASModuleUserData* m_pUserData;
+
+	const bool m_bReplaceExisting;
+
+	std::unique_ptr<CScriptBuilder> m_ScriptBuilder;
+
+	std::vector<CASModuleDependency> m_Dependencies;
+
+	CASModuleBuildStats m_Stats;
+
+	std::future<CASModuleManager::CompileResult> m_Result;
+
+	bool m_bFinished = false;
+
+private:
+	CASAsyncModuleBuild( const CASAsyncModuleBuild& ) = delete;
+	CASAsyncModuleBuild& operator=( const CASAsyncModuleBuild& ) = delete;
+};
+
+/** @} */
+
+#endif //ANGELSCRIPT_CASASYNCMODULEBUILD_H
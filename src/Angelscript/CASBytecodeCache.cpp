@@ -0,0 +1,423 @@
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#ifndef WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "add_on/scriptbuilder.h"
+
+#include "util/ASLogging.h"
+#include "util/ASPlatform.h"
+#include "util/CASFileBinaryStream.h"
+#include "util/CASMemoryBinaryStream.h"
+#include "util/StringUtils.h"
+
+#include "CASModuleDescriptor.h"
+
+#include "CASBytecodeCache.h"
+
+const char CASBytecodeCache::FILE_EXTENSION[] = ".asbc";
+
+namespace
+{
+const char CACHE_FILE_MAGIC[ 4 ] = { 'A', 'S', 'B', 'C' };
+
+/*
+*	Increment this whenever the layout of cache files changes.
+*/
+const uint32_t CACHE_FILE_VERSION = 1;
+
+struct CacheFileHeader final
+{
+	char szMagic[ sizeof( CACHE_FILE_MAGIC ) ];
+	uint32_t uiVersion;
+	uint64_t uiKey;
+	uint64_t uiSize;
+};
+
+uint64_t HashString( const char* const pszString, const uint64_t uiHash )
+{
+	return as::Hash64( pszString ? pszString : "", uiHash );
+}
+
+template<typename T>
+uint64_t HashValue( const T value, const uint64_t uiHash )
+{
+	return as::Hash64( &value, sizeof( value ), uiHash );
+}
+
+uint64_t HashFunction( const asIScriptFunction* pFunction, uint64_t uiHash )
+{
+	if( !pFunction )
+		return HashValue( 0, uiHash );
+
+	uiHash = HashString( pFunction->GetDeclaration( true, true, false ), uiHash );
+
+	return HashValue( pFunction->GetAccessMask(), uiHash );
+}
+
+uint64_t HashType( const asITypeInfo* pType, uint64_t uiHash )
+{
+	uiHash = HashString( pType->GetNamespace(), uiHash );
+	uiHash = HashString( pType->GetName(), uiHash );
+	uiHash = HashValue( pType->GetFlags(), uiHash );
+	uiHash = HashValue( pType->GetSize(), uiHash );
+	uiHash = HashValue( pType->GetAccessMask(), uiHash );
+	uiHash = HashValue( pType->GetSubTypeCount(), uiHash );
+
+	for( asUINT uiIndex = 0; uiIndex < pType->GetFactoryCount(); ++uiIndex )
+	{
+		uiHash = HashFunction( pType->GetFactoryByIndex( uiIndex ), uiHash );
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < pType->GetBehaviourCount(); ++uiIndex )
+	{
+		asEBehaviours behaviour;
+
+		auto pFunction = pType->GetBehaviourByIndex( uiIndex, &behaviour );
+
+		uiHash = HashValue( behaviour, uiHash );
+		uiHash = HashFunction( pFunction, uiHash );
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < pType->GetMethodCount(); ++uiIndex )
+	{
+		uiHash = HashFunction( pType->GetMethodByIndex( uiIndex, false ), uiHash );
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < pType->GetPropertyCount(); ++uiIndex )
+	{
+		uiHash = HashString( pType->GetPropertyDeclaration( uiIndex, true ), uiHash );
+	}
+
+	return uiHash;
+}
+
+bool CreateDirectoryHierarchy( const std::string& szDirectory )
+{
+	std::string szPath = szDirectory;
+
+	for( auto& c : szPath )
+	{
+		if( c == '\\' )
+			c = '/';
+	}
+
+	//Make each directory. Errors are ignored here since the directories may already exist.
+	for( size_t uiPos = szPath.find( '/', 1 ); uiPos != std::string::npos; uiPos = szPath.find( '/', uiPos + 1 ) )
+	{
+		szPath[ uiPos ] = '\0';
+		MakeDirectory( szPath.c_str() );
+		szPath[ uiPos ] = '/';
+	}
+
+	MakeDirectory( szPath.c_str() );
+
+#ifdef WIN32
+	const DWORD attributes = GetFileAttributesA( szPath.c_str() );
+
+	return attributes != INVALID_FILE_ATTRIBUTES && ( attributes & FILE_ATTRIBUTE_DIRECTORY );
+#else
+	struct stat info;
+
+	return stat( szPath.c_str(), &info ) == 0 && S_ISDIR( info.st_mode );
+#endif
+}
+
+bool ReplaceCacheFile( const std::string& szSource, const std::string& szDestination )
+{
+	//rename doesn't overwrite existing files on all platforms.
+	remove( szDestination.c_str() );
+
+	return rename( szSource.c_str(), szDestination.c_str() ) == 0;
+}
+}
+
+CASBytecodeCache::CASBytecodeCache( asIScriptEngine& engine, const char* const pszDirectory )
+	: m_Engine( engine )
+	, m_szDirectory( pszDirectory ? pszDirectory : "" )
+{
+	m_Engine.AddRef();
+
+	while( !m_szDirectory.empty() && ( m_szDirectory.back() == '/' || m_szDirectory.back() == '\\' ) )
+		m_szDirectory.pop_back();
+
+	if( m_szDirectory.empty() )
+		m_szDirectory = ".";
+
+	if( !CreateDirectoryHierarchy( m_szDirectory ) )
+		as::Critical( "CASBytecodeCache: Could not create cache directory \"%s\"\n", m_szDirectory.c_str() );
+}
+
+CASBytecodeCache::~CASBytecodeCache()
+{
+	m_Engine.Release();
+}
+
+uint64_t CASBytecodeCache::GetEngineFingerprint()
+{
+	if( !m_bHasFingerprint )
+	{
+		m_uiFingerprint = ComputeEngineFingerprint( m_Engine );
+		m_bHasFingerprint = true;
+	}
+
+	return m_uiFingerprint;
+}
+
+uint64_t CASBytecodeCache::ComputeEngineFingerprint( asIScriptEngine& engine )
+{
+	uint64_t uiHash = as::FNV1A64_OFFSET_BASIS;
+
+	uiHash = HashString( ANGELSCRIPT_VERSION_STRING, uiHash );
+	uiHash = HashString( asGetLibraryOptions(), uiHash );
+
+	for( asUINT uiIndex = 0; uiIndex < engine.GetObjectTypeCount(); ++uiIndex )
+	{
+		uiHash = HashType( engine.GetObjectTypeByIndex( uiIndex ), uiHash );
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < engine.GetGlobalFunctionCount(); ++uiIndex )
+	{
+		uiHash = HashFunction( engine.GetGlobalFunctionByIndex( uiIndex ), uiHash );
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < engine.GetGlobalPropertyCount(); ++uiIndex )
+	{
+		const char* pszName;
+		const char* pszNamespace;
+		int iTypeId;
+		bool bIsConst;
+		asDWORD accessMask;
+
+		engine.GetGlobalPropertyByIndex( uiIndex, &pszName, &pszNamespace, &iTypeId, &bIsConst, nullptr, nullptr, &accessMask );
+
+		uiHash = HashString( pszNamespace, uiHash );
+		uiHash = HashString( pszName, uiHash );
+		uiHash = HashString( engine.GetTypeDeclaration( iTypeId, true ), uiHash );
+		uiHash = HashValue( bIsConst, uiHash );
+		uiHash = HashValue( accessMask, uiHash );
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < engine.GetFuncdefCount(); ++uiIndex )
+	{
+		auto pFuncdef = engine.GetFuncdefByIndex( uiIndex );
+
+		uiHash = HashFunction( pFuncdef->GetFuncdefSignature(), uiHash );
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < engine.GetEnumCount(); ++uiIndex )
+	{
+		auto pEnum = engine.GetEnumByIndex( uiIndex );
+
+		uiHash = HashString( pEnum->GetNamespace(), uiHash );
+		uiHash = HashString( pEnum->GetName(), uiHash );
+
+		for( asUINT uiValue = 0; uiValue < pEnum->GetEnumValueCount(); ++uiValue )
+		{
+			int iValue;
+
+			uiHash = HashString( pEnum->GetEnumValueByIndex( uiValue, &iValue ), uiHash );
+			uiHash = HashValue( iValue, uiHash );
+		}
+	}
+
+	for( asUINT uiIndex = 0; uiIndex < engine.GetTypedefCount(); ++uiIndex )
+	{
+		auto pTypedef = engine.GetTypedefByIndex( uiIndex );
+
+		uiHash = HashString( pTypedef->GetNamespace(), uiHash );
+		uiHash = HashString( pTypedef->GetName(), uiHash );
+		uiHash = HashString( engine.GetTypeDeclaration( pTypedef->GetTypedefTypeId(), true ), uiHash );
+	}
+
+	return uiHash;
+}
+
+std::string CASBytecodeCache::GetFilename( const CASModuleDescriptor& descriptor, const char* const pszModuleName ) const
+{
+	assert( pszModuleName );
+
+	std::string szFilename = m_szDirectory + '/';
+
+	//Keep the module name readable, the hash disambiguates names that map to the same characters.
+	for( auto pszNext = pszModuleName; *pszNext; ++pszNext )
+	{
+		const char c = *pszNext;
+
+		szFilename += ( isalnum( static_cast<unsigned char>( c ) ) || c == '_' || c == '-' ) ? c : '_';
+	}
+
+	char szHash[ 32 ];
+
+	const uint64_t uiNameHash = HashString( pszModuleName, HashString( descriptor.GetName(), as::FNV1A64_OFFSET_BASIS ) );
+
+	snprintf( szHash, sizeof( szHash ), "_%016llx", static_cast<unsigned long long>( uiNameHash ) );
+
+	szFilename += szHash;
+	szFilename += FILE_EXTENSION;
+
+	return szFilename;
+}
+
+bool CASBytecodeCache::Load( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const uint64_t uiSourceHash, CScriptBuilder& builder )
+{
+	assert( pszModuleName );
+
+	const auto szFilename = GetFilename( descriptor, pszModuleName );
+
+	CASFileBinaryStream stream( szFilename.c_str(), CASFileBinaryStream::Mode::READ );
+
+	CacheFileHeader header;
+
+	if( stream.IsOpen() )
+		stream.Read( &header, sizeof( header ) );
+
+	if( !stream.IsOpen() ||
+		stream.HasFailed() ||
+		memcmp( header.szMagic, CACHE_FILE_MAGIC, sizeof( CACHE_FILE_MAGIC ) ) ||
+		header.uiVersion != CACHE_FILE_VERSION ||
+		header.uiKey != ComputeKey( descriptor, pszModuleName, uiSourceHash ) )
+	{
+		++m_Stats.uiMisses;
+		return false;
+	}
+
+	//Truncated or padded files can't be trusted.
+	if( stream.GetRemainingBytes() != header.uiSize ||
+		builder.BuildModuleFromByteCode( &stream ) < 0 ||
+		stream.HasFailed() )
+	{
+		as::Msg( "CASBytecodeCache: Cache entry \"%s\" for module \"%s\" could not be loaded, recompiling\n", szFilename.c_str(), pszModuleName );
+
+		++m_Stats.uiFailures;
+		++m_Stats.uiMisses;
+		return false;
+	}
+
+	++m_Stats.uiHits;
+
+	return true;
+}
+
+bool CASBytecodeCache::Store( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const uint64_t uiSourceHash, asIScriptModule& module )
+{
+	assert( pszModuleName );
+
+	//Collect the bytecode in memory first so its size is known.
+	CASMemoryBinaryStream buffer;
+
+	//Debug info is kept so error messages and debuggers still have line numbers.
+	if( module.SaveByteCode( &buffer, false ) < 0 )
+	{
+		++m_Stats.uiFailures;
+		return false;
+	}
+
+	CacheFileHeader header;
+
+	memcpy( header.szMagic, CACHE_FILE_MAGIC, sizeof( CACHE_FILE_MAGIC ) );
+	header.uiVersion = CACHE_FILE_VERSION;
+	header.uiKey = ComputeKey( descriptor, pszModuleName, uiSourceHash );
+	header.uiSize = buffer.GetWrittenData().size();
+
+	const auto szFilename = GetFilename( descriptor, pszModuleName );
+
+	//Write to a temporary file first so a partially written file never replaces a valid entry.
+	const auto szTempFilename = szFilename + ".tmp";
+
+	CASFileBinaryStream stream( szTempFilename.c_str(), CASFileBinaryStream::Mode::WRITE );
+
+	stream.Write( &header, sizeof( header ) );
+
+	if( !buffer.GetWrittenData().empty() )
+		stream.Write( buffer.GetWrittenData().data(), static_cast<asUINT>( buffer.GetWrittenData().size() ) );
+
+	if( !stream.Close() || !ReplaceCacheFile( szTempFilename, szFilename ) )
+	{
+		as::Critical( "CASBytecodeCache: Could not write cache entry \"%s\" for module \"%s\"\n", szFilename.c_str(), pszModuleName );
+
+		remove( szTempFilename.c_str() );
+
+		++m_Stats.uiFailures;
+		return false;
+	}
+
+	++m_Stats.uiStores;
+
+	return true;
+}
+
+bool CASBytecodeCache::Invalidate( const CASModuleDescriptor& descriptor, const char* const pszModuleName )
+{
+	assert( pszModuleName );
+
+	if( !pszModuleName )
+		return false;
+
+	return remove( GetFilename( descriptor, pszModuleName ).c_str() ) == 0;
+}
+
+size_t CASBytecodeCache::InvalidateAll()
+{
+	size_t uiRemoved = 0;
+
+	const size_t uiExtensionLength = strlen( FILE_EXTENSION );
+
+	auto removeIfCacheFile = [ & ]( const char* const pszName )
+	{
+		const size_t uiLength = strlen( pszName );
+
+		if( uiLength > uiExtensionLength && strcmp( pszName + uiLength - uiExtensionLength, FILE_EXTENSION ) == 0 )
+		{
+			if( remove( ( m_szDirectory + '/' + pszName ).c_str() ) == 0 )
+				++uiRemoved;
+		}
+	};
+
+#ifdef WIN32
+	WIN32_FIND_DATAA data;
+
+	HANDLE hFind = FindFirstFileA( ( m_szDirectory + "/*" ).c_str(), &data );
+
+	if( hFind != INVALID_HANDLE_VALUE )
+	{
+		do
+		{
+			if( !( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+				removeIfCacheFile( data.cFileName );
+		}
+		while( FindNextFileA( hFind, &data ) );
+
+		FindClose( hFind );
+	}
+#else
+	if( auto pDir = opendir( m_szDirectory.c_str() ) )
+	{
+		while( auto pEntry = readdir( pDir ) )
+		{
+			removeIfCacheFile( pEntry->d_name );
+		}
+
+		closedir( pDir );
+	}
+#endif
+
+	return uiRemoved;
+}
+
+uint64_t CASBytecodeCache::ComputeKey( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const uint64_t uiSourceHash )
+{
+	uint64_t uiKey = HashValue( GetEngineFingerprint(), as::FNV1A64_OFFSET_BASIS );
+
+	uiKey = HashValue( uiSourceHash, uiKey );
+	uiKey = HashString( descriptor.GetName(), uiKey );
+	uiKey = HashValue( descriptor.GetAccessMask(), uiKey );
+	uiKey = HashString( pszModuleName, uiKey );
+
+	return uiKey;
+}
@@ -0,0 +1,164 @@
+#ifndef ANGELSCRIPT_CASBYTECODECACHE_H
+#define ANGELSCRIPT_CASBYTECODECACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include <angelscript.h>
+
+class CASModuleDescriptor;
+class CScriptBuilder;
+
+/**
+*	@addtogroup ASModule
+*
+*	@{
+*/
+
+/**
+*	Statistics kept by the bytecode cache.
+*/
+struct CASBytecodeCacheStats final
+{
+	/**
+	*	Number of modules that were loaded from the cache.
+	*/
+	size_t uiHits = 0;
+
+	/**
+	*	Number of modules that had no usable cache entry and had to be compiled.
+	*/
+	size_t uiMisses = 0;
+
+	/**
+	*	Number of modules that were written to the cache.
+	*/
+	size_t uiStores = 0;
+
+	/**
+	*	Number of cache entries that matched but could not be loaded, or could not be written.
+	*/
+	size_t uiFailures = 0;
+};
+
+/**
+*	Persistent cache of compiled module bytecode.
+*	Entries are keyed on the descriptor, the module name, a hash of the script sources and a fingerprint of the engine's registered API.
+*	If any of those change, the entry is considered stale and the module is compiled again.
+*/
+class CASBytecodeCache final
+{
+public:
+	/**
+	*	The extension used for cache files.
+	*/
+	static const char FILE_EXTENSION[];
+
+public:
+	/**
+	*	Constructor.
+	*	@param engine Script engine.
+	*	@param pszDirectory Directory to store cache files in. Created if it does not exist.
+	*/
+	CASBytecodeCache( asIScriptEngine& engine, const char* const pszDirectory );
+
+	/**
+	*	Destructor.
+	*/
+	~CASBytecodeCache();
+
+	/**
+	*	@return The directory that cache files are stored in.
+	*/
+	const std::string& GetDirectory() const { return m_szDirectory; }
+
+	/**
+	*	@return The fingerprint of the engine's registered API. Computed on first use.
+	*/
+	uint64_t GetEngineFingerprint();
+
+	/**
+	*	Forces the engine fingerprint to be recomputed. Call this if the application registers more API after modules have been built.
+	*/
+	void ResetEngineFingerprint() { m_bHasFingerprint = false; }
+
+	/**
+	*	Computes a fingerprint of everything the application registered with the engine.
+	*	@param engine Script engine.
+	*	@return Fingerprint.
+	*/
+	static uint64_t ComputeEngineFingerprint( asIScriptEngine& engine );
+
+	/**
+	*	@return The statistics for this cache.
+	*/
+	const CASBytecodeCacheStats& GetStats() const { return m_Stats; }
+
+	/**
+	*	Resets the statistics for this cache.
+	*/
+	void ResetStats() { m_Stats = CASBytecodeCacheStats(); }
+
+	/**
+	*	Gets the name of the file that caches the given module.
+	*	@param descriptor Descriptor of the module.
+	*	@param pszModuleName Name of the module.
+	*	@return Filename.
+	*/
+	std::string GetFilename( const CASModuleDescriptor& descriptor, const char* const pszModuleName ) const;
+
+	/**
+	*	Attempts to load a module from the cache.
+	*	@param descriptor Descriptor of the module.
+	*	@param pszModuleName Name of the module.
+	*	@param uiSourceHash Hash of the script sources that went into the module.
+	*	@param builder Builder whose module should receive the bytecode. All sections must have been added to it already.
+	*	@return true if the module was loaded from the cache, false if it should be compiled.
+	*/
+	bool Load( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const uint64_t uiSourceHash, CScriptBuilder& builder );
+
+	/**
+	*	Stores a compiled module in the cache.
+	*	@param descriptor Descriptor of the module.
+	*	@param pszModuleName Name of the module.
+	*	@param uiSourceHash Hash of the script sources that went into the module.
+	*	@param module Compiled module.
+	*	@return Whether the module was stored.
+	*/
+	bool Store( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const uint64_t uiSourceHash, asIScriptModule& module );
+
+	/**
+	*	Removes the cache entry for the given module.
+	*	@param descriptor Descriptor of the module.
+	*	@param pszModuleName Name of the module.
+	*	@return Whether an entry was removed.
+	*/
+	bool Invalidate( const CASModuleDescriptor& descriptor, const char* const pszModuleName );
+
+	/**
+	*	Removes all cache entries in the cache directory.
+	*	@return Number of entries that were removed.
+	*/
+	size_t InvalidateAll();
+
+private:
+	uint64_t ComputeKey( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const uint64_t uiSourceHash );
+
+private:
+	asIScriptEngine& m_Engine;
+
+	std::string m_szDirectory;
+
+	uint64_t m_uiFingerprint = 0;
+	bool m_bHasFingerprint = false;
+
+	CASBytecodeCacheStats m_Stats;
+
+private:
+	CASBytecodeCache( const CASBytecodeCache& ) = delete;
+	CASBytecodeCache& operator=( const CASBytecodeCache& ) = delete;
+};
+
+/** @} */
+
+#endif //ANGELSCRIPT_CASBYTECODECACHE_H
@@ -0,0 +1,136 @@
+#include <algorithm>
+
+#include "util/ASUtil.h"
+
+#include "CASIncludeCache.h"
+
+namespace
+{
+uint64_t HashDefinedWords( const std::set<std::string>& definedWords )
+{
+	uint64_t uiHash = as::FNV1A64_OFFSET_BASIS;
+
+	for( const auto& szWord : definedWords )
+	{
+		uiHash = as::Hash64( szWord.c_str(), uiHash );
+	}
+
+	return uiHash;
+}
+
+}
+
+std::shared_ptr<const CScriptSectionCache::SEntry> CASIncludeCache::Find( const char* filename, const std::set<std::string>& definedWords, SFileVersion& outVersion )
+{
+	const auto uiDefinesHash = HashDefinedWords( definedWords );
+
+	int64_t iModificationTime;
+	uint64_t uiFileSize;
+
+	const bool bHasInfo = as::GetFileInfo( filename, iModificationTime, uiFileSize );
+
+	//Files that were modified very recently may change again without their time changing, so they aren't stored until later.
+	outVersion.modificationTime = iModificationTime;
+	outVersion.size = uiFileSize;
+	outVersion.valid = bHasInfo && !as::IsRecentModification( iModificationTime );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Files.find( filename );
+
+	if( it != m_Files.end() )
+	{
+		auto& entries = it->second;
+
+		//All entries for a file were made from the same contents, so if one is stale, all of them are.
+		if( !bHasInfo || entries.front().iModificationTime != iModificationTime || entries.front().uiFileSize != uiFileSize )
+		{
+			m_Stats.uiStale += entries.size();
+			m_Files.erase( it );
+		}
+		else
+		{
+			for( const auto& entry : entries )
+			{
+				if( entry.uiDefinesHash == uiDefinesHash )
+				{
+					++m_Stats.uiHits;
+					return entry.Section;
+				}
+			}
+		}
+	}
+
+	++m_Stats.uiMisses;
+
+	return nullptr;
+}
+
+void CASIncludeCache::Store( const char* filename, const std::set<std::string>& definedWords, const SFileVersion& version, const std::shared_ptr<const SEntry>& entry )
+{
+	if( !version.valid )
+		return;
+
+	Entry newEntry;
+
+	newEntry.uiDefinesHash = HashDefinedWords( definedWords );
+	newEntry.iModificationTime = version.modificationTime;
+	newEntry.uiFileSize = version.size;
+	newEntry.Section = entry;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto& entries = m_Files[ filename ];
+
+	//The file changed since the other entries were made.
+	if( !entries.empty() && ( entries.front().iModificationTime != newEntry.iModificationTime || entries.front().uiFileSize != newEntry.uiFileSize ) )
+	{
+		m_Stats.uiStale += entries.size();
+		entries.clear();
+	}
+
+	auto it = std::find_if( entries.begin(), entries.end(), [ & ]( const Entry& other )
+	{
+		return other.uiDefinesHash == newEntry.uiDefinesHash;
+	} );
+
+	if( it != entries.end() )
+		*it = std::move( newEntry );
+	else
+		entries.emplace_back( std::move( newEntry ) );
+}
+
+size_t CASIncludeCache::GetEntryCount() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	size_t uiCount = 0;
+
+	for( const auto& file : m_Files )
+	{
+		uiCount += file.second.size();
+	}
+
+	return uiCount;
+}
+
+CASIncludeCacheStats CASIncludeCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_Stats;
+}
+
+void CASIncludeCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Stats = CASIncludeCacheStats();
+}
+
+void CASIncludeCache::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Files.clear();
+}
@@ -0,0 +1,104 @@
+#ifndef ANGELSCRIPT_CASINCLUDECACHE_H
+#define ANGELSCRIPT_CASINCLUDECACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "add_on/scriptbuilder.h"
+
+/**
+*	@addtogroup ASModule
+*
+*	@{
+*/
+
+/**
+*	Statistics kept by the include cache.
+*/
+struct CASIncludeCacheStats final
+{
+	/**
+	*	Number of files that were served from the cache.
+	*/
+	size_t uiHits = 0;
+
+	/**
+	*	Number of files that had to be loaded and preprocessed.
+	*/
+	size_t uiMisses = 0;
+
+	/**
+	*	Number of entries that were dropped because their file changed.
+	*/
+	size_t uiStale = 0;
+};
+
+/**
+*	In-memory cache of preprocessed script files, shared between module builds.
+*	Entries are keyed on the absolute path of the file and the words defined by the builder.
+*	A file is considered changed if its modification time or size differ from when it was loaded.
+*	Files modified within as::RECENT_MODIFICATION_WINDOW of being loaded aren't cached until a later build.
+*	Each entry keeps the code as it was loaded, which builders need to report the section, and the edits made by preprocessing.
+*	This costs one copy of every cached file, but that copy is shared by every build that includes the file.
+*	Thread safe, so asynchronous builds can use it.
+*/
+class CASIncludeCache final : public CScriptSectionCache
+{
+public:
+	CASIncludeCache() = default;
+	~CASIncludeCache() = default;
+
+	std::shared_ptr<const SEntry> Find( const char* filename, const std::set<std::string>& definedWords, SFileVersion& outVersion ) override;
+
+	void Store( const char* filename, const std::set<std::string>& definedWords, const SFileVersion& version, const std::shared_ptr<const SEntry>& entry ) override;
+
+	/**
+	*	@return The number of cached entries.
+	*/
+	size_t GetEntryCount() const;
+
+	/**
+	*	@return The statistics for this cache.
+	*/
+	CASIncludeCacheStats GetStats() const;
+
+	/**
+	*	Resets the statistics for this cache.
+	*/
+	void ResetStats();
+
+	/**
+	*	Removes all entries.
+	*/
+	void Clear();
+
+private:
+	struct Entry final
+	{
+		uint64_t uiDefinesHash;
+		int64_t iModificationTime;
+		uint64_t uiFileSize;
+		std::shared_ptr<const SEntry> Section;
+	};
+
+	typedef std::unordered_map<std::string, std::vector<Entry>> Files_t;
+
+private:
+	mutable std::mutex m_Mutex;
+
+	Files_t m_Files;
+
+	CASIncludeCacheStats m_Stats;
+
+private:
+	CASIncludeCache( const CASIncludeCache& ) = delete;
+	CASIncludeCache& operator=( const CASIncludeCache& ) = delete;
+};
+
+/** @} */
+
+#endif //ANGELSCRIPT_CASINCLUDECACHE_H
@@ -6,6 +6,8 @@
 #include "Angelscript/util/ASLogging.h"
 #include "Angelscript/util/ASUtil.h"
 
+#include "CASModuleMemory.h"
+
 #include "IASContextResultHandler.h"
 #include "IASInitializer.h"
 
@@ -54,6 +56,12 @@ bool CASManager::Initialize( IASInitializer& initializer )
 		return true;
 	}
 
+	//Memory functions must be set before the engine allocates anything.
+	if( initializer.UseMemoryTracking() && !as::InstallMemoryTracking() )
+	{
+		as::Critical( "CASManager::Initialize: Could not install memory tracking\n" );
+	}
+
 	m_pScriptEngine = asCreateScriptEngine( ANGELSCRIPT_VERSION );
 
 	if( !m_pScriptEngine )
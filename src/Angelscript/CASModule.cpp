@@ -5,6 +5,7 @@
 #include "ScriptAPI/CASScheduler.h"
 
 #include "CASModule.h"
+#include "CASModuleMemory.h"
 
 CASModule::CASModule( asIScriptModule* pModule, const CASModuleDescriptor& descriptor, IASModuleUserData* pUserData )
 	: m_pModule( pModule )
@@ -15,6 +16,8 @@ CASModule::CASModule( asIScriptModule* pModule, const CASModuleDescriptor& descr
 	assert( pModule );
 
 	pModule->SetUserData( this, CASMODULE_USER_DATA_ID );
+
+	m_pMemory = CASModuleMemory::Create( *pModule );
 }
 
 CASModule::~CASModule()
@@ -24,6 +27,12 @@ CASModule::~CASModule()
 	//Discard should've been called first.
 	assert( !m_pModule );
 
+	if( m_pMemory )
+	{
+		m_pMemory->Release();
+		m_pMemory = nullptr;
+	}
+
 	//Delete last, in case code calls it during destruction
 	delete m_pScheduler;
 }
@@ -40,9 +49,17 @@ void CASModule::Discard()
 {
 	//Clears out the functions that might be holding references to this module
 	m_pScheduler->ClearTimerList();
+	m_pScheduler->ClearResolvedFunctions();
 
 	if( m_pModule )
 	{
+		//Stop attributing allocations before the module goes away. Its script objects may outlive it.
+		if( m_pMemory )
+		{
+			m_pMemory->Release();
+			m_pMemory = nullptr;
+		}
+
 		m_pModule->Discard();
 		m_pModule = nullptr;
 	}
@@ -1,13 +1,17 @@
 #ifndef ANGELSCRIPT_CASMODULE_H
 #define ANGELSCRIPT_CASMODULE_H
 
+#include <cstdint>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "util/CASBaseClass.h"
 
 #include "CASModuleDescriptor.h"
 
 class asIScriptModule;
+class CASModuleMemory;
 class CASScheduler;
 
 /**
@@ -34,6 +38,120 @@ inline IASModuleUserData::~IASModuleUserData()
 {
 }
 
+/**
+*	A script section that a module was built from.
+*/
+struct CASModuleDependency final
+{
+	/**
+	*	Name of the section. For files, this is the absolute path.
+	*/
+	std::string szName;
+
+	/**
+	*	Hash of the section's contents, before preprocessing.
+	*/
+	uint64_t uiHash = 0;
+
+	/**
+	*	Whether the section was loaded from a file. Only files are checked for changes when reloading.
+	*/
+	bool bIsFile = false;
+
+	/**
+	*	For files, the modification time in nanoseconds and size at the time of the build. Files whose time and size are unchanged are not hashed again.
+	*	A time of 0 means the time can't be trusted because the file was modified shortly before the build, so the file is always hashed.
+	*/
+	int64_t iModificationTime = 0;
+	uint64_t uiFileSize = 0;
+};
+
+/**
+*	Statistics gathered while building a module. Times are in seconds.
+*/
+struct CASModuleBuildStats final
+{
+	/**
+	*	Time spent in IASModuleBuilder::DefineWords, excluding includes.
+	*/
+	double flDefineWordsTime = 0;
+
+	/**
+	*	Time spent in IASModuleBuilder::AddScripts, including preprocessing but excluding includes.
+	*/
+	double flAddScriptsTime = 0;
+
+	/**
+	*	Time spent resolving, loading and preprocessing includes, in any stage.
+	*/
+	double flIncludeTime = 0;
+
+	/**
+	*	Time spent in IASModuleBuilder::PreBuild, excluding includes.
+	*/
+	double flPreBuildTime = 0;
+
+	/**
+	*	Time spent compiling the module and processing metadata, or loading it from the bytecode cache.
+	*/
+	double flBuildTime = 0;
+
+	/**
+	*	Time spent in IASModuleBuilder::PostBuild.
+	*/
+	double flPostBuildTime = 0;
+
+	/**
+	*	Number of script sections, and their size in bytes before preprocessing.
+	*/
+	size_t uiSectionCount = 0;
+	uint64_t uiSourceBytes = 0;
+
+	/**
+	*	Contents of the resulting module. Types include object types, enums and typedefs.
+	*/
+	size_t uiFunctionCount = 0;
+	size_t uiTypeCount = 0;
+	size_t uiGlobalCount = 0;
+
+	/**
+	*	Size in bytes of the bytecode of the module's functions, including methods of its types.
+	*/
+	size_t uiBytecodeSize = 0;
+
+	/**
+	*	Size in bytes of the module's global variables. Handles count as a pointer, objects as their type's size.
+	*/
+	size_t uiGlobalSize = 0;
+
+	/**
+	*	@return Total time spent building.
+	*/
+	double GetTotalTime() const
+	{
+		return flDefineWordsTime + flAddScriptsTime + flIncludeTime + flPreBuildTime + flBuildTime + flPostBuildTime;
+	}
+
+	CASModuleBuildStats& operator+=( const CASModuleBuildStats& other )
+	{
+		flDefineWordsTime += other.flDefineWordsTime;
+		flAddScriptsTime += other.flAddScriptsTime;
+		flIncludeTime += other.flIncludeTime;
+		flPreBuildTime += other.flPreBuildTime;
+		flBuildTime += other.flBuildTime;
+		flPostBuildTime += other.flPostBuildTime;
+		uiSectionCount += other.uiSectionCount;
+		uiSourceBytes += other.uiSourceBytes;
+		uiFunctionCount += other.uiFunctionCount;
+		uiTypeCount += other.uiTypeCount;
+		uiGlobalCount += other.uiGlobalCount;
+		uiBytecodeSize += other.uiBytecodeSize;
+		uiGlobalSize += other.uiGlobalSize;
+
+		return *this;
+	}
+};
+
 /**
 *	The user data ID for the CASModule instance in asIScriptModule.
 */
@@ -102,6 +220,42 @@ public:
 		m_pUserData = pUserData;
 	}
 
+	/**
+	*	@return The script sections this module was built from, including includes.
+	*/
+	const std::vector<CASModuleDependency>& GetDependencies() const { return m_Dependencies; }
+
+	/**
+	*	Sets the script sections this module was built from.
+	*/
+	void SetDependencies( std::vector<CASModuleDependency>&& dependencies )
+	{
+		m_Dependencies = std::move( dependencies );
+	}
+
+	/**
+	*	@return Statistics gathered while building this module.
+	*/
+	const CASModuleBuildStats& GetBuildStats() const { return m_BuildStats; }
+
+	/**
+	*	Sets the statistics gathered while building this module.
+	*/
+	void SetBuildStats( const CASModuleBuildStats& stats )
+	{
+		m_BuildStats = stats;
+	}
+
+	/**
+	*	@return Memory accounting for this module, or null if memory tracking isn't installed.
+	*/
+	CASModuleMemory* GetMemory() { return m_pMemory; }
+
+	/**
+	*	@copydoc GetMemory()
+	*/
+	const CASModuleMemory* GetMemory() const { return m_pMemory; }
+
 private:
 	asIScriptModule* m_pModule;
 
@@ -111,6 +265,12 @@ private:
 
 	IASModuleUserData* m_pUserData = nullptr;
 
+	std::vector<CASModuleDependency> m_Dependencies;
+
+	CASModuleBuildStats m_BuildStats;
+
+	CASModuleMemory* m_pMemory = nullptr;
+
 private:
 	CASModule( const CASModule& ) = delete;
 	CASModule& operator=( const CASModule& ) = delete;
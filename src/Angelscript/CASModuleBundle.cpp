@@ -0,0 +1,275 @@
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "util/ASLogging.h"
+#include "util/CASFileBinaryStream.h"
+#include "util/CASMemoryBinaryStream.h"
+
+#include "CASBytecodeCache.h"
+#include "CASModule.h"
+
+#include "CASModuleBundle.h"
+
+/*
+*	Bundle layout, all values are in native byte order:
+*	BundleHeader
+*	BundleIndexEntry[ header.uiModuleCount ]
+*	String table of null terminated names, header.uiStringTableSize bytes
+*	Bytecode of each module, starting at 8 byte aligned offsets
+*/
+namespace
+{
+const char BUNDLE_MAGIC[ 4 ] = { 'A', 'S', 'B', 'N' };
+
+/*
+*	Increment this whenever the layout of bundles changes.
+*/
+const uint32_t BUNDLE_VERSION = 1;
+
+const size_t BUNDLE_ALIGNMENT = 8;
+
+struct BundleHeader final
+{
+	char szMagic[ sizeof( BUNDLE_MAGIC ) ];
+	uint32_t uiVersion;
+	uint64_t uiFingerprint;
+	uint32_t uiModuleCount;
+	uint32_t uiStringTableSize;
+};
+
+struct BundleIndexEntry final
+{
+	/*
+	*	Offset from the start of the file.
+	*/
+	uint64_t uiOffset;
+	uint64_t uiSize;
+
+	/*
+	*	Offsets into the string table.
+	*/
+	uint32_t uiDescriptorName;
+	uint32_t uiModuleName;
+};
+
+size_t Align( const size_t uiValue )
+{
+	return ( uiValue + BUNDLE_ALIGNMENT - 1 ) & ~( BUNDLE_ALIGNMENT - 1 );
+}
+
+void WritePadding( CASFileBinaryStream& stream, const size_t uiCurrent )
+{
+	const char padding[ BUNDLE_ALIGNMENT ] = {};
+
+	if( const size_t uiPadding = Align( uiCurrent ) - uiCurrent )
+		stream.Write( padding, static_cast<asUINT>( uiPadding ) );
+}
+}
+
+CASModuleBundleWriter::CASModuleBundleWriter( asIScriptEngine& engine )
+	: m_Engine( engine )
+{
+	m_Engine.AddRef();
+}
+
+CASModuleBundleWriter::~CASModuleBundleWriter()
+{
+	m_Engine.Release();
+}
+
+bool CASModuleBundleWriter::AddModule( CASModule& module )
+{
+	auto pScriptModule = module.GetModule();
+
+	assert( pScriptModule );
+
+	if( !pScriptModule )
+		return false;
+
+	CASMemoryBinaryStream stream;
+
+	if( pScriptModule->SaveByteCode( &stream, true ) < 0 )
+	{
+		as::Critical( "CASModuleBundleWriter::AddModule: Could not save bytecode for module \"%s\"\n", module.GetModuleName() );
+		return false;
+	}
+
+	m_Modules.push_back( Module{ module.GetDescriptor().GetName(), module.GetModuleName(), stream.GetWrittenData() } );
+
+	return true;
+}
+
+bool CASModuleBundleWriter::Write( const char* const pszFilename ) const
+{
+	assert( pszFilename );
+
+	if( !pszFilename )
+		return false;
+
+	std::vector<char> stringTable;
+
+	auto addString = [ & ]( const std::string& szString )
+	{
+		const auto uiOffset = static_cast<uint32_t>( stringTable.size() );
+
+		stringTable.insert( stringTable.end(), szString.c_str(), szString.c_str() + szString.length() + 1 );
+
+		return uiOffset;
+	};
+
+	std::vector<BundleIndexEntry> index;
+
+	index.reserve( m_Modules.size() );
+
+	for( const auto& module : m_Modules )
+	{
+		BundleIndexEntry entry;
+
+		entry.uiOffset = 0;
+		entry.uiSize = module.Bytecode.size();
+		entry.uiDescriptorName = addString( module.szDescriptorName );
+		entry.uiModuleName = addString( module.szModuleName );
+
+		index.push_back( entry );
+	}
+
+	size_t uiOffset = Align( sizeof( BundleHeader ) + sizeof( BundleIndexEntry ) * index.size() + stringTable.size() );
+
+	for( auto& entry : index )
+	{
+		entry.uiOffset = uiOffset;
+
+		uiOffset = Align( uiOffset + static_cast<size_t>( entry.uiSize ) );
+	}
+
+	BundleHeader header;
+
+	memcpy( header.szMagic, BUNDLE_MAGIC, sizeof( BUNDLE_MAGIC ) );
+	header.uiVersion = BUNDLE_VERSION;
+	header.uiFingerprint = CASBytecodeCache::ComputeEngineFingerprint( m_Engine );
+	header.uiModuleCount = static_cast<uint32_t>( index.size() );
+	header.uiStringTableSize = static_cast<uint32_t>( stringTable.size() );
+
+	CASFileBinaryStream stream( pszFilename, CASFileBinaryStream::Mode::WRITE );
+
+	if( !stream.IsOpen() )
+	{
+		as::Critical( "CASModuleBundleWriter::Write: Could not open \"%s\" for writing\n", pszFilename );
+		return false;
+	}
+
+	stream.Write( &header, sizeof( header ) );
+
+	if( !index.empty() )
+		stream.Write( index.data(), static_cast<asUINT>( sizeof( BundleIndexEntry ) * index.size() ) );
+
+	if( !stringTable.empty() )
+		stream.Write( stringTable.data(), static_cast<asUINT>( stringTable.size() ) );
+
+	WritePadding( stream, sizeof( BundleHeader ) + sizeof( BundleIndexEntry ) * index.size() + stringTable.size() );
+
+	for( size_t uiIndex = 0; uiIndex < m_Modules.size(); ++uiIndex )
+	{
+		const auto& bytecode = m_Modules[ uiIndex ].Bytecode;
+
+		if( !bytecode.empty() )
+			stream.Write( bytecode.data(), static_cast<asUINT>( bytecode.size() ) );
+
+		WritePadding( stream, static_cast<size_t>( index[ uiIndex ].uiOffset + index[ uiIndex ].uiSize ) );
+	}
+
+	if( !stream.Close() )
+	{
+		as::Critical( "CASModuleBundleWriter::Write: Error while writing \"%s\"\n", pszFilename );
+		remove( pszFilename );
+		return false;
+	}
+
+	return true;
+}
+
+bool CASModuleBundle::Open( const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	Close();
+
+	if( !pszFilename )
+		return false;
+
+	if( !m_File.Open( pszFilename ) )
+	{
+		as::Critical( "CASModuleBundle::Open: Could not map \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	auto pData = reinterpret_cast<const char*>( m_File.GetData() );
+	const size_t uiSize = m_File.GetSize();
+
+	auto fail = [ & ]( const char* const pszReason )
+	{
+		as::Critical( "CASModuleBundle::Open: \"%s\" is not a valid bundle: %s\n", pszFilename, pszReason );
+		Close();
+		return false;
+	};
+
+	if( uiSize < sizeof( BundleHeader ) )
+		return fail( "file too small" );
+
+	//The mapping is page aligned, so the header and index can be accessed in place.
+	auto& header = *reinterpret_cast<const BundleHeader*>( pData );
+
+	if( memcmp( header.szMagic, BUNDLE_MAGIC, sizeof( BUNDLE_MAGIC ) ) )
+		return fail( "bad magic" );
+
+	if( header.uiVersion != BUNDLE_VERSION )
+		return fail( "unsupported version" );
+
+	//Check the count against the remaining size first so a crafted count can't overflow the index size on 32 bit builds.
+	if( header.uiModuleCount > ( uiSize - sizeof( BundleHeader ) ) / sizeof( BundleIndexEntry ) )
+		return fail( "truncated index" );
+
+	const size_t uiIndexEnd = sizeof( BundleHeader ) + sizeof( BundleIndexEntry ) * header.uiModuleCount;
+
+	if( uiSize - uiIndexEnd < header.uiStringTableSize )
+		return fail( "truncated index" );
+
+	auto pIndex = reinterpret_cast<const BundleIndexEntry*>( pData + sizeof( BundleHeader ) );
+	auto pStringTable = pData + uiIndexEnd;
+
+	auto isValidString = [ & ]( const uint32_t uiOffset )
+	{
+		return uiOffset < header.uiStringTableSize && memchr( pStringTable + uiOffset, '\0', header.uiStringTableSize - uiOffset );
+	};
+
+	m_Entries.reserve( header.uiModuleCount );
+
+	for( uint32_t uiIndex = 0; uiIndex < header.uiModuleCount; ++uiIndex )
+	{
+		const auto& entry = pIndex[ uiIndex ];
+
+		if( !isValidString( entry.uiDescriptorName ) || !isValidString( entry.uiModuleName ) )
+			return fail( "bad module name" );
+
+		if( entry.uiOffset > uiSize || uiSize - entry.uiOffset < entry.uiSize )
+			return fail( "module out of bounds" );
+
+		m_Entries.push_back( Entry{
+			pStringTable + entry.uiDescriptorName,
+			pStringTable + entry.uiModuleName,
+			pData + entry.uiOffset,
+			static_cast<size_t>( entry.uiSize ) } );
+	}
+
+	m_uiFingerprint = header.uiFingerprint;
+
+	return true;
+}
+
+void CASModuleBundle::Close()
+{
+	m_Entries.clear();
+	m_uiFingerprint = 0;
+	m_File.Close();
+}
@@ -0,0 +1,147 @@
+#ifndef ANGELSCRIPT_CASMODULEBUNDLE_H
+#define ANGELSCRIPT_CASMODULEBUNDLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <angelscript.h>
+
+#include "util/CASMappedFile.h"
+
+class CASModule;
+
+/**
+*	@addtogroup ASModule
+*
+*	@{
+*/
+
+/**
+*	The extension used for module bundles.
+*/
+#define AS_MODULE_BUNDLE_EXTENSION ".asbn"
+
+/**
+*	Collects compiled modules and writes them to a bundle file.
+*	A bundle contains a header, an index of modules and the bytecode of each module with debug info stripped.
+*	Bundles are only valid for engines with the same registered API as the one used to compile them.
+*/
+class CASModuleBundleWriter final
+{
+public:
+	/**
+	*	Constructor.
+	*	@param engine Script engine that the modules were compiled with.
+	*/
+	CASModuleBundleWriter( asIScriptEngine& engine );
+
+	~CASModuleBundleWriter();
+
+	/**
+	*	@return The number of modules that have been added.
+	*/
+	size_t GetModuleCount() const { return m_Modules.size(); }
+
+	/**
+	*	Saves a module's bytecode and adds it to the bundle.
+	*	@param module Module to add.
+	*	@return Whether the module was added.
+	*/
+	bool AddModule( CASModule& module );
+
+	/**
+	*	Writes all added modules to a bundle file.
+	*	@param pszFilename Name of the file to write.
+	*	@return Whether the file was written.
+	*/
+	bool Write( const char* const pszFilename ) const;
+
+private:
+	struct Module
+	{
+		std::string szDescriptorName;
+		std::string szModuleName;
+		std::vector<char> Bytecode;
+	};
+
+private:
+	asIScriptEngine& m_Engine;
+
+	std::vector<Module> m_Modules;
+
+private:
+	CASModuleBundleWriter( const CASModuleBundleWriter& ) = delete;
+	CASModuleBundleWriter& operator=( const CASModuleBundleWriter& ) = delete;
+};
+
+/**
+*	A module bundle mapped into memory.
+*	The index is validated when the bundle is opened, after that the bytecode can be loaded straight from the mapping.
+*/
+class CASModuleBundle final
+{
+public:
+	/**
+	*	A single module in a bundle. Pointers are valid until the bundle is closed.
+	*/
+	struct Entry
+	{
+		const char* pszDescriptorName;
+		const char* pszModuleName;
+		const void* pBytecode;
+		size_t uiBytecodeSize;
+	};
+
+public:
+	CASModuleBundle() = default;
+	~CASModuleBundle() = default;
+
+	/**
+	*	@return Whether a bundle is open.
+	*/
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	/**
+	*	@return The fingerprint of the engine that the bundle was compiled with.
+	*	@see CASBytecodeCache::ComputeEngineFingerprint
+	*/
+	uint64_t GetEngineFingerprint() const { return m_uiFingerprint; }
+
+	/**
+	*	@return The number of modules in the bundle.
+	*/
+	size_t GetModuleCount() const { return m_Entries.size(); }
+
+	/**
+	*	@return The module at the given index.
+	*/
+	const Entry& GetModule( const size_t uiIndex ) const { return m_Entries[ uiIndex ]; }
+
+	/**
+	*	Opens a bundle. If a bundle is already open, it is closed first.
+	*	@param pszFilename Name of the bundle file.
+	*	@return Whether the bundle was opened and is valid.
+	*/
+	bool Open( const char* const pszFilename );
+
+	/**
+	*	Closes the bundle.
+	*/
+	void Close();
+
+private:
+	CASMappedFile m_File;
+
+	uint64_t m_uiFingerprint = 0;
+
+	std::vector<Entry> m_Entries;
+
+private:
+	CASModuleBundle( const CASModuleBundle& ) = delete;
+	CASModuleBundle& operator=( const CASModuleBundle& ) = delete;
+};
+
+/** @} */
+
+#endif //ANGELSCRIPT_CASMODULEBUNDLE_H
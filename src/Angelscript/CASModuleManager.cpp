@@ -1,13 +1,24 @@
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdio>
 
 #include "add_on/scriptbuilder.h"
 
 #include "event/CASEventManager.h"
 
+#include "util/ASLogging.h"
+#include "util/ASUtil.h"
+#include "util/CASMemoryBinaryStream.h"
+#include "util/CASRefPtr.h"
+
+#include "CASAsyncModuleBuild.h"
 #include "CASModule.h"
+#include "CASModuleBundle.h"
+#include "CASModuleMemory.h"
 
 #include "IASModuleBuilder.h"
+#include "IASModuleReloadHandler.h"
 
 #include "CASModuleManager.h"
 
@@ -71,15 +82,280 @@ std::pair<const CASModuleDescriptor*, bool> CASModuleManager::AddDescriptor( con
 	return std::make_pair( result.first->second.get(), true );
 }
 
+namespace
+{
+size_t GetByteCodeSize( asIScriptFunction* pFunction )
+{
+	if( !pFunction )
+		return 0;
+
+	asUINT uiLength = 0;
+
+	pFunction->GetByteCode( &uiLength );
+
+	return uiLength * sizeof( asDWORD );
+}
+
+/*
+*	Computes the size of the bytecode of all functions in a module, including methods, behaviours and factories of its types.
+*/
+size_t ComputeByteCodeSize( const asIScriptModule& module )
+{
+	size_t uiSize = 0;
+
+	for( asUINT uiIndex = 0; uiIndex < module.GetFunctionCount(); ++uiIndex )
+	{
+		uiSize += GetByteCodeSize( module.GetFunctionByIndex( uiIndex ) );
+	}
+
+	for( asUINT uiType = 0; uiType < module.GetObjectTypeCount(); ++uiType )
+	{
+		auto pType = module.GetObjectTypeByIndex( uiType );
+
+		for( asUINT uiIndex = 0; uiIndex < pType->GetMethodCount(); ++uiIndex )
+		{
+			uiSize += GetByteCodeSize( pType->GetMethodByIndex( uiIndex, false ) );
+		}
+
+		for( asUINT uiIndex = 0; uiIndex < pType->GetBehaviourCount(); ++uiIndex )
+		{
+			uiSize += GetByteCodeSize( pType->GetBehaviourByIndex( uiIndex, nullptr ) );
+		}
+
+		for( asUINT uiIndex = 0; uiIndex < pType->GetFactoryCount(); ++uiIndex )
+		{
+			uiSize += GetByteCodeSize( pType->GetFactoryByIndex( uiIndex ) );
+		}
+	}
+
+	return uiSize;
+}
+
+/*
+*	Computes the size of a module's global variables. Handles are counted as pointers, objects as the size of their type.
+*/
+size_t ComputeGlobalSize( const asIScriptModule& module )
+{
+	auto& engine = *module.GetEngine();
+
+	size_t uiSize = 0;
+
+	for( asUINT uiIndex = 0; uiIndex < module.GetGlobalVarCount(); ++uiIndex )
+	{
+		int iTypeId;
+
+		if( module.GetGlobalVar( uiIndex, nullptr, nullptr, &iTypeId ) < 0 )
+			continue;
+
+		if( iTypeId & asTYPEID_OBJHANDLE )
+		{
+			uiSize += sizeof( void* );
+		}
+		else if( iTypeId & asTYPEID_MASK_OBJECT )
+		{
+			auto pType = engine.GetTypeInfoById( iTypeId );
+
+			uiSize += pType ? pType->GetSize() : sizeof( void* );
+		}
+		else
+		{
+			uiSize += engine.GetSizeOfPrimitiveType( iTypeId );
+		}
+	}
+
+	return uiSize;
+}
+
+/*
+*	Adds the time spent in a scope to a counter. Can be paused to exclude time spent elsewhere.
+*/
+class CASScopedTimer final
+{
+public:
+	CASScopedTimer( double& flTime )
+		: m_flTime( flTime )
+		, m_Start( std::chrono::high_resolution_clock::now() )
+	{
+	}
+
+	~CASScopedTimer()
+	{
+		Pause();
+	}
+
+	void Pause()
+	{
+		if( m_bRunning )
+		{
+			m_flTime += std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - m_Start ).count();
+			m_bRunning = false;
+		}
+	}
+
+	void Resume()
+	{
+		if( !m_bRunning )
+		{
+			m_Start = std::chrono::high_resolution_clock::now();
+			m_bRunning = true;
+		}
+	}
+
+private:
+	double& m_flTime;
+	std::chrono::high_resolution_clock::time_point m_Start;
+	bool m_bRunning = true;
+};
+
+/*
+*	State used by the include callback.
+*/
+struct CASIncludeState final
+{
+	IASModuleBuilder& builder;
+	CASModuleBuildStats& stats;
+
+	//Includes can be nested, only the outermost include is timed.
+	int iDepth;
+
+	//Timer of the build stage that is running, paused while includes are processed.
+	CASScopedTimer* pStageTimer;
+};
+
+/*
+*	The sources that went into a module.
+*/
+struct CASModuleSources final
+{
+	uint64_t uiHash = as::FNV1A64_OFFSET_BASIS;
+
+	uint64_t uiBytes = 0;
+
+	std::vector<CASModuleDependency> Dependencies;
+};
+
+bool GetDependencyFileInfo( const char* const pszFilename, int64_t& iModificationTime, uint64_t& uiSize )
+{
+	if( !as::GetFileInfo( pszFilename, iModificationTime, uiSize ) )
+		return false;
+
+	//Don't trust the time of recently modified files, so they're hashed the next time they're checked.
+	if( as::IsRecentModification( iModificationTime ) )
+		iModificationTime = 0;
+
+	return true;
+}
+
+bool HashFile( const char* const pszFilename, uint64_t& uiHash )
+{
+	std::unique_ptr<FILE, int ( * )( FILE* )> file( fopen( pszFilename, "rb" ), ::fclose );
+
+	if( !file )
+		return false;
+
+	uiHash = as::FNV1A64_OFFSET_BASIS;
+
+	char buffer[ 8192 ];
+
+	size_t uiRead;
+
+	while( ( uiRead = fread( buffer, 1, sizeof( buffer ), file.get() ) ) > 0 )
+	{
+		uiHash = as::Hash64( buffer, uiRead, uiHash );
+	}
+
+	return !ferror( file.get() );
+}
+}
+
 /*
 *	Include callback for builders.
 */
 static int CASModuleManager_IncludeCallback( const char* pszFileName, const char* pszFrom, CScriptBuilder* pBuilder, void* pUserParam )
 {
-	return reinterpret_cast<IASModuleBuilder*>( pUserParam )->IncludeScript( *pBuilder, pszFileName, pszFrom ) ? 0 : -1;
+	auto& state = *reinterpret_cast<CASIncludeState*>( pUserParam );
+
+	//Nested includes are part of the outermost include's time.
+	if( state.iDepth > 0 )
+		return state.builder.IncludeScript( *pBuilder, pszFileName, pszFrom ) ? 0 : -1;
+
+	if( state.pStageTimer )
+		state.pStageTimer->Pause();
+
+	bool bResult;
+
+	{
+		CASScopedTimer timer( state.stats.flIncludeTime );
+
+		++state.iDepth;
+
+		bResult = state.builder.IncludeScript( *pBuilder, pszFileName, pszFrom );
+
+		--state.iDepth;
+	}
+
+	if( state.pStageTimer )
+		state.pStageTimer->Resume();
+
+	return bResult ? 0 : -1;
+}
+
+/*
+*	Section callback for builders. Records the sources that go into a module.
+*/
+static void CASModuleManager_SectionCallback( const char* pszSectionName, const char* pszCode, unsigned int uiLength, CScriptBuilder* pBuilder, void* pUserParam )
+{
+	auto& sources = *reinterpret_cast<CASModuleSources*>( pUserParam );
+
+	CASModuleDependency dependency;
+
+	dependency.szName = pszSectionName;
+	dependency.uiHash = as::Hash64( pszCode, uiLength );
+	dependency.bIsFile = pBuilder->IsSectionFromFile( pszSectionName );
+
+	if( dependency.bIsFile )
+		GetDependencyFileInfo( pszSectionName, dependency.iModificationTime, dependency.uiFileSize );
+
+	sources.uiHash = as::Hash64( pszSectionName, sources.uiHash );
+	sources.uiHash = as::Hash64( &dependency.uiHash, sizeof( dependency.uiHash ), sources.uiHash );
+
+	sources.uiBytes += uiLength;
+
+	sources.Dependencies.emplace_back( std::move( dependency ) );
+}
+
+CASBytecodeCache* CASModuleManager::EnableBytecodeCache( const char* const pszDirectory )
+{
+	assert( pszDirectory );
+
+	if( !pszDirectory )
+		return nullptr;
+
+	m_BytecodeCache = std::make_unique<CASBytecodeCache>( m_Engine, pszDirectory );
+
+	return m_BytecodeCache.get();
+}
+
+void CASModuleManager::DisableBytecodeCache()
+{
+	m_BytecodeCache.reset();
+}
+
+CASIncludeCache* CASModuleManager::EnableIncludeCache()
+{
+	if( !m_IncludeCache )
+		m_IncludeCache = std::make_unique<CASIncludeCache>();
+
+	return m_IncludeCache.get();
+}
+
+void CASModuleManager::DisableIncludeCache()
+{
+	m_IncludeCache.reset();
 }
 
-CASModule* CASModuleManager::BuildModule( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData )
+CASModule* CASModuleManager::BuildModule( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData,
+										  CASModuleBuildStats* pStats )
 {
 	if( descriptor.GetDescriptorID() == as::INVALID_DESCRIPTOR_ID || FindDescriptorByName( descriptor.GetName() ) != &descriptor )
 	{
@@ -89,10 +365,11 @@ CASModule* CASModuleManager::BuildModule( const CASModuleDescriptor& descriptor,
 		return nullptr;
 	}
 
-	return BuildModuleInternal( descriptor, pszModuleName, builder, pUserData );
+	return BuildModuleInternal( descriptor, pszModuleName, builder, pUserData, pStats );
 }
 
-CASModule* CASModuleManager::BuildModule( const char* const pszName, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData )
+CASModule* CASModuleManager::BuildModule( const char* const pszName, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData,
+										  CASModuleBuildStats* pStats )
 {
 	auto pDescriptor = FindDescriptorByName( pszName );
 
@@ -104,10 +381,72 @@ CASModule* CASModuleManager::BuildModule( const char* const pszName, const char*
 		return nullptr;
 	}
 
-	return BuildModuleInternal( *pDescriptor, pszModuleName, builder, pUserData );
+	return BuildModuleInternal( *pDescriptor, pszModuleName, builder, pUserData, pStats );
+}
+
+std::vector<CASModule*> CASModuleManager::BuildModules( const CASModuleBuildRequest* pRequests, const size_t uiCount )
+{
+	assert( pRequests || !uiCount );
+
+	std::vector<CASModule*> modules;
+
+	if( !pRequests )
+		return modules;
+
+	modules.reserve( uiCount );
+
+	BeginDeferredSort();
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& request = pRequests[ uiIndex ];
+
+		assert( request.pDescriptor && request.pBuilder );
+
+		if( !request.pDescriptor || !request.pBuilder )
+		{
+			if( request.pUserData )
+				request.pUserData->Release();
+
+			modules.push_back( nullptr );
+			continue;
+		}
+
+		modules.push_back( BuildModule( *request.pDescriptor, request.pszModuleName, *request.pBuilder, request.pUserData ) );
+	}
+
+	EndDeferredSort();
+
+	return modules;
+}
+
+std::unique_ptr<CASAsyncModuleBuild> CASModuleManager::BuildModuleAsync( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder,
+																		 IASModuleUserData* pUserData, const bool bReplaceExisting )
+{
+	assert( pszModuleName );
+
+	if( descriptor.GetDescriptorID() == as::INVALID_DESCRIPTOR_ID || FindDescriptorByName( descriptor.GetName() ) != &descriptor ||
+		!pszModuleName || !( *pszModuleName ) )
+	{
+		if( pUserData )
+			pUserData->Release();
+
+		return nullptr;
+	}
+
+	//Build under a unique name so existing modules aren't replaced until the build is finished.
+	char szScriptModuleName[ 64 ];
+
+	snprintf( szScriptModuleName, sizeof( szScriptModuleName ), "$async%u", m_uiAsyncBuildCount++ );
+
+	//Decremented by the build once its compilation has finished.
+	++m_uiRunningAsyncBuilds;
+
+	return std::make_unique<CASAsyncModuleBuild>( *this, descriptor, pszModuleName, ( pszModuleName + std::string( szScriptModuleName ) ).c_str(), builder, pUserData, bReplaceExisting );
 }
 
-CASModule* CASModuleManager::BuildModuleInternal( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData )
+CASModule* CASModuleManager::BuildModuleInternal( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData,
+												  CASModuleBuildStats* pStats )
 {
 	struct CleanupUserDataOnExit final
 	{
@@ -142,15 +481,60 @@ CASModule* CASModuleManager::BuildModuleInternal( const CASModuleDescriptor& des
 
 	CScriptBuilder scriptBuilder;
 
-	scriptBuilder.SetIncludeCallback( &::CASModuleManager_IncludeCallback, &builder );
+	std::vector<CASModuleDependency> dependencies;
 
-	auto result = scriptBuilder.StartNewModule( &m_Engine, pszModuleName );
+	CASModuleBuildStats stats;
 
-	if( result < 0 )
+	const auto result = CompileModule( descriptor, pszModuleName, pszModuleName, builder, scriptBuilder, dependencies, stats );
+
+	if( result == CompileResult::ABORTED )
 	{
+		RecordBuildStats( stats );
+
+		if( pStats )
+			*pStats = stats;
+
 		return nullptr;
 	}
 
+	//FinishBuild takes care of this now.
+	cleanupUserData.Release();
+
+	auto pModule = FinishBuild( descriptor, scriptBuilder, &builder, result == CompileResult::SUCCESS, pUserData, stats );
+
+	if( pStats )
+		*pStats = stats;
+
+	if( pModule )
+		pModule->SetDependencies( std::move( dependencies ) );
+
+	return pModule;
+}
+
+CASModuleManager::CompileResult CASModuleManager::CompileModule( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const char* const pszScriptModuleName,
+																 IASModuleBuilder& builder, CScriptBuilder& scriptBuilder, std::vector<CASModuleDependency>& dependencies,
+																 CASModuleBuildStats& stats )
+{
+	CASIncludeState includeState{ builder, stats, 0, nullptr };
+
+	scriptBuilder.SetIncludeCallback( &::CASModuleManager_IncludeCallback, &includeState );
+
+	CASModuleSources sources;
+
+	scriptBuilder.SetSectionCallback( &::CASModuleManager_SectionCallback, &sources );
+
+	scriptBuilder.SetSectionCache( m_IncludeCache.get() );
+
+	//Zero copy changes an engine wide property, which isn't safe while another thread is adding sections.
+	scriptBuilder.SetZeroCopyBlocked( m_uiRunningAsyncBuilds > 0 );
+
+	auto result = scriptBuilder.StartNewModule( &m_Engine, pszScriptModuleName );
+
+	if( result < 0 )
+	{
+		return CompileResult::ABORTED;
+	}
+
 	auto pScriptModule = scriptBuilder.GetModule();
 
 	pScriptModule->SetAccessMask( descriptor.GetAccessMask() );
@@ -176,56 +560,368 @@ CASModule* CASModuleManager::BuildModuleInternal( const CASModuleDescriptor& des
 		}
 	} cleanupModule( pScriptModule );
 
-	if( !builder.DefineWords( scriptBuilder ) )
+	bool bResult;
+
 	{
-		return nullptr;
+		CASScopedTimer timer( stats.flDefineWordsTime );
+		includeState.pStageTimer = &timer;
+		bResult = builder.DefineWords( scriptBuilder );
+		includeState.pStageTimer = nullptr;
 	}
 
-	if( !builder.AddScripts( scriptBuilder ) )
+	if( !bResult )
 	{
-		return nullptr;
+		return CompileResult::ABORTED;
 	}
 
-	if( !builder.PreBuild( scriptBuilder ) )
 	{
-		return nullptr;
+		CASScopedTimer timer( stats.flAddScriptsTime );
+		includeState.pStageTimer = &timer;
+		bResult = builder.AddScripts( scriptBuilder );
+		includeState.pStageTimer = nullptr;
 	}
 
-	CASModule* pModule = nullptr;
+	stats.uiSectionCount = sources.Dependencies.size();
+	stats.uiSourceBytes = sources.uiBytes;
+
+	if( !bResult )
+	{
+		return CompileResult::ABORTED;
+	}
+
+	{
+		CASScopedTimer timer( stats.flPreBuildTime );
+		includeState.pStageTimer = &timer;
+		bResult = builder.PreBuild( scriptBuilder );
+		includeState.pStageTimer = nullptr;
+	}
+
+	if( !bResult )
+	{
+		return CompileResult::ABORTED;
+	}
+
+	//The caller takes care of the module now.
+	cleanupModule.Release();
+
+	//Defined words change the outcome of preprocessing, so they're part of the sources.
+	for( const auto& szWord : scriptBuilder.GetDefinedWords() )
+	{
+		sources.uiHash = as::Hash64( szWord.c_str(), sources.uiHash );
+	}
+
+	dependencies = std::move( sources.Dependencies );
+
+	//The engine can only build one module at a time, and the cache isn't thread safe.
+	std::lock_guard<std::mutex> lock( m_CompileMutex );
+
+	CASScopedTimer timer( stats.flBuildTime );
+
+	const bool bLoadedFromCache = m_BytecodeCache && m_BytecodeCache->Load( descriptor, pszModuleName, sources.uiHash, scriptBuilder );
 
-	const bool bSuccess = scriptBuilder.BuildModule() >= 0;
+	const bool bSuccess = bLoadedFromCache || scriptBuilder.BuildModule() >= 0;
+
+	if( bSuccess && m_BytecodeCache && !bLoadedFromCache )
+		m_BytecodeCache->Store( descriptor, pszModuleName, sources.uiHash, *scriptBuilder.GetModule() );
+
+	return bSuccess ? CompileResult::SUCCESS : CompileResult::FAILED;
+}
+
+CASModule* CASModuleManager::FinishBuild( const CASModuleDescriptor& descriptor, CScriptBuilder& scriptBuilder, IASModuleBuilder* pBuilder, const bool bSuccess, IASModuleUserData* pUserData,
+										  CASModuleBuildStats& stats )
+{
+	CASModule* pModule = nullptr;
 
 	if( bSuccess )
 	{
-		pModule = new CASModule( scriptBuilder.GetModule(), descriptor, pUserData );
-		cleanupUserData.Release();
-		cleanupModule.Release();
+		auto pScriptModule = scriptBuilder.GetModule();
+
+		stats.uiFunctionCount = pScriptModule->GetFunctionCount();
+		stats.uiTypeCount = pScriptModule->GetObjectTypeCount() + pScriptModule->GetEnumCount() + pScriptModule->GetTypedefCount();
+		stats.uiGlobalCount = pScriptModule->GetGlobalVarCount();
+		stats.uiBytecodeSize = ComputeByteCodeSize( *pScriptModule );
+		stats.uiGlobalSize = ComputeGlobalSize( *pScriptModule );
+
+		pModule = new CASModule( pScriptModule, descriptor, pUserData );
+
+		if( m_uiDefaultMemoryQuota && pModule->GetMemory() )
+			pModule->GetMemory()->SetQuota( m_uiDefaultMemoryQuota, m_DefaultMemoryQuotaMode );
 	}
 
-	//Don't enter this if statement if bSuccess is false, that gets handled right after.
-	if( !builder.PostBuild( scriptBuilder, bSuccess, pModule ) && bSuccess )
+	bool bKeep = true;
+
+	if( pBuilder )
 	{
-		delete pModule;
-		return nullptr;
+		CASScopedTimer timer( stats.flPostBuildTime );
+		bKeep = pBuilder->PostBuild( scriptBuilder, bSuccess, pModule );
 	}
 
+	RecordBuildStats( stats );
+
 	if( !bSuccess )
 	{
+		scriptBuilder.GetModule()->Discard();
+
+		if( pUserData )
+			pUserData->Release();
+
 		return nullptr;
 	}
 
-	if( !AddModule( pModule ) )
+	if( !bKeep || !AddModule( pModule ) )
 	{
-		delete pModule;
+		//PostBuild may have added references, so don't delete it outright.
+		pModule->Discard();
+		pModule->Release();
 		return nullptr;
 	}
 
+	pModule->SetBuildStats( stats );
+
 	//This manager now holds a reference to the module. PostBuild may have added more references.
 	pModule->Release();
 
 	return pModule;
 }
 
+size_t CASModuleManager::LoadModuleBundle( const char* const pszFilename, IASModuleBuilder* pBuilder )
+{
+	assert( pszFilename );
+
+	if( !pszFilename )
+		return 0;
+
+	CASModuleBundle bundle;
+
+	if( !bundle.Open( pszFilename ) )
+		return 0;
+
+	if( bundle.GetEngineFingerprint() != CASBytecodeCache::ComputeEngineFingerprint( m_Engine ) )
+	{
+		as::Critical( "CASModuleManager::LoadModuleBundle: Bundle \"%s\" was compiled against a different API, recompile it\n", pszFilename );
+		return 0;
+	}
+
+	size_t uiLoaded = 0;
+
+	for( size_t uiIndex = 0; uiIndex < bundle.GetModuleCount(); ++uiIndex )
+	{
+		const auto& entry = bundle.GetModule( uiIndex );
+
+		auto pDescriptor = FindDescriptorByName( entry.pszDescriptorName );
+
+		if( !pDescriptor )
+		{
+			as::Critical( "CASModuleManager::LoadModuleBundle: Module \"%s\" uses unknown descriptor \"%s\"\n", entry.pszModuleName, entry.pszDescriptorName );
+			continue;
+		}
+
+		if( FindModuleByName( entry.pszModuleName ) )
+		{
+			as::Critical( "CASModuleManager::LoadModuleBundle: Module \"%s\" already exists\n", entry.pszModuleName );
+			continue;
+		}
+
+		CScriptBuilder scriptBuilder;
+
+		if( scriptBuilder.StartNewModule( &m_Engine, entry.pszModuleName ) < 0 )
+			continue;
+
+		scriptBuilder.GetModule()->SetAccessMask( pDescriptor->GetAccessMask() );
+
+		CASMemoryBinaryStream stream( entry.pBytecode, entry.uiBytecodeSize );
+
+		CASModuleBuildStats stats;
+
+		bool bSuccess;
+
+		{
+			//The engine can only build one module at a time, and async builds may be compiling.
+			std::lock_guard<std::mutex> lock( m_CompileMutex );
+
+			CASScopedTimer timer( stats.flBuildTime );
+			bSuccess = scriptBuilder.BuildModuleFromByteCode( &stream ) >= 0 && !stream.HasFailed();
+		}
+
+		if( FinishBuild( *pDescriptor, scriptBuilder, pBuilder, bSuccess, nullptr, stats ) )
+			++uiLoaded;
+	}
+
+	return uiLoaded;
+}
+
+void CASModuleManager::RecordBuildStats( const CASModuleBuildStats& stats )
+{
+	m_TotalBuildStats += stats;
+	++m_uiBuildCount;
+}
+
+void CASModuleManager::ResetBuildStats()
+{
+	m_TotalBuildStats = CASModuleBuildStats();
+	m_uiBuildCount = 0;
+}
+
+std::vector<CASModuleMemoryReport> CASModuleManager::GetMemoryReport() const
+{
+	std::vector<CASModuleMemoryReport> report;
+
+	report.reserve( m_Modules.size() );
+
+	for( auto pModule : m_Modules )
+	{
+		CASModuleMemoryReport entry;
+
+		entry.szModuleName = pModule->GetModuleName();
+		entry.uiBytecodeSize = pModule->GetBuildStats().uiBytecodeSize;
+		entry.uiGlobalSize = pModule->GetBuildStats().uiGlobalSize;
+
+		if( auto pMemory = pModule->GetMemory() )
+		{
+			entry.uiLiveBytes = pMemory->GetLiveBytes();
+			entry.uiLiveAllocations = pMemory->GetLiveAllocations();
+			entry.uiPeakBytes = pMemory->GetPeakBytes();
+			entry.uiQuota = pMemory->GetQuota();
+			entry.bQuotaExceeded = pMemory->IsQuotaExceeded();
+		}
+
+		report.emplace_back( std::move( entry ) );
+	}
+
+	return report;
+}
+
+void CASModuleManager::LogMemoryReport() const
+{
+	const auto report = GetMemoryReport();
+
+	as::Msg( "%u modules:\n", static_cast<unsigned int>( report.size() ) );
+
+	for( const auto& entry : report )
+	{
+		as::Msg( "\"%s\": bytecode %u, globals %u, live %u bytes in %u allocations, peak %u",
+			entry.szModuleName.c_str(),
+			static_cast<unsigned int>( entry.uiBytecodeSize ), static_cast<unsigned int>( entry.uiGlobalSize ),
+			static_cast<unsigned int>( entry.uiLiveBytes ), static_cast<unsigned int>( entry.uiLiveAllocations ),
+			static_cast<unsigned int>( entry.uiPeakBytes ) );
+
+		if( entry.uiQuota )
+			as::Msg( ", quota %u%s", static_cast<unsigned int>( entry.uiQuota ), entry.bQuotaExceeded ? " (exceeded)" : "" );
+
+		as::Msg( "\n" );
+	}
+}
+
+bool CASModuleManager::HasModuleChanged( const CASModule& module ) const
+{
+	FileHashes_t fileHashes;
+
+	return HasModuleChanged( module, fileHashes );
+}
+
+bool CASModuleManager::HasModuleChanged( const CASModule& module, FileHashes_t& fileHashes ) const
+{
+	for( const auto& dependency : module.GetDependencies() )
+	{
+		if( !dependency.bIsFile )
+			continue;
+
+		int64_t iModificationTime;
+		uint64_t uiFileSize;
+
+		//Deleted files count as changes so the rebuild reports the error.
+		if( !as::GetFileInfo( dependency.szName.c_str(), iModificationTime, uiFileSize ) )
+			return true;
+
+		if( dependency.iModificationTime != 0 && iModificationTime == dependency.iModificationTime && uiFileSize == dependency.uiFileSize )
+			continue;
+
+		//Touched files may still have the same contents.
+		auto it = fileHashes.find( dependency.szName );
+
+		if( it == fileHashes.end() )
+		{
+			uint64_t uiHash;
+
+			if( !HashFile( dependency.szName.c_str(), uiHash ) )
+				return true;
+
+			it = fileHashes.emplace( dependency.szName, uiHash ).first;
+		}
+
+		if( it->second != dependency.uiHash )
+			return true;
+	}
+
+	return false;
+}
+
+CASModule* CASModuleManager::ReloadModule( CASModule& module, IASModuleBuilder& builder, IASModuleUserData* pUserData )
+{
+	auto pScriptModule = module.GetModule();
+
+	assert( pScriptModule );
+
+	if( !pScriptModule || FindModule( &module ) == m_Modules.end() )
+	{
+		if( pUserData )
+			pUserData->Release();
+
+		return nullptr;
+	}
+
+	const std::string szModuleName = pScriptModule->GetName();
+
+	//Move the old module out of the way so the new one can be built under the same name. The old one stays functional until the new one is ready.
+	RenameModule( module, ( szModuleName + "$reloading" ).c_str() );
+
+	auto pNewModule = BuildModuleInternal( module.GetDescriptor(), szModuleName.c_str(), builder, pUserData );
+
+	if( !pNewModule )
+	{
+		RenameModule( module, szModuleName.c_str() );
+		return nullptr;
+	}
+
+	RemoveModule( &module );
+
+	return pNewModule;
+}
+
+CASModuleReloadResult CASModuleManager::ReloadChanged( IASModuleReloadHandler& handler )
+{
+	CASModuleReloadResult result;
+
+	FileHashes_t fileHashes;
+
+	//Reloading changes the module list, so work on a copy.
+	std::vector<CASRefPtr<CASModule>> modules( m_Modules.begin(), m_Modules.end() );
+
+	for( auto& module : modules )
+	{
+		//Removed while reloading another module.
+		if( !module->GetModule() )
+			continue;
+
+		const std::string szModuleName = module->GetModuleName();
+
+		IASModuleBuilder* pBuilder = nullptr;
+
+		if( !HasModuleChanged( *module, fileHashes ) || !( pBuilder = handler.GetBuilder( *module ) ) )
+		{
+			result.Skipped.push_back( szModuleName );
+			continue;
+		}
+
+		if( ReloadModule( *module, *pBuilder, handler.CreateUserData( *module ) ) )
+			result.Reloaded.push_back( szModuleName );
+		else
+			result.Failed.push_back( szModuleName );
+	}
+
+	return result;
+}
+
 size_t CASModuleManager::GetModuleCount() const
 {
 	return m_Modules.size();
@@ -238,9 +934,9 @@ const CASModule* CASModuleManager::FindModuleByName( const char* const pszModule
 	if( !pszModuleName )
 		return nullptr;
 
-	auto it = std::find_if( m_Modules.begin(), m_Modules.end(), ModuleEqualByName( pszModuleName ) );
+	auto it = m_ModulesByName.find( pszModuleName );
 
-	return it != m_Modules.end() ? *it : nullptr;
+	return it != m_ModulesByName.end() ? it->second : nullptr;
 }
 
 CASModule* CASModuleManager::FindModuleByName( const char* const pszModuleName )
@@ -260,6 +956,17 @@ CASModule* CASModuleManager::FindModuleByIndex( const size_t uiIndex )
 	return const_cast<CASModule*>( const_cast<const CASModuleManager*>( this )->FindModuleByIndex( uiIndex ) );
 }
 
+CASModuleManager::Modules_t::iterator CASModuleManager::FindModule( const CASModule* pModule )
+{
+	if( m_iDeferSortCount > 0 )
+		return std::find( m_Modules.begin(), m_Modules.end(), pModule );
+
+	//ModuleLess is a strict total order, so the module can only be at this position.
+	auto it = std::lower_bound( m_Modules.begin(), m_Modules.end(), pModule, ModuleLess );
+
+	return ( it != m_Modules.end() && *it == pModule ) ? it : m_Modules.end();
+}
+
 bool CASModuleManager::AddModule( CASModule* pModule )
 {
 	assert( pModule );
@@ -267,24 +974,57 @@ bool CASModuleManager::AddModule( CASModule* pModule )
 	if( !pModule )
 		return false;
 
-	if( FindModuleByName( pModule->GetModuleName() ) )
+	auto result = m_ModulesByName.emplace( pModule->GetModuleName(), pModule );
+
+	if( !result.second )
 		return false;
 
 	pModule->AddRef();
 
-	m_Modules.push_back( pModule );
-
-	std::stable_sort( m_Modules.begin(), m_Modules.end(), ModuleLess );
+	if( m_iDeferSortCount > 0 )
+		m_Modules.push_back( pModule );
+	else
+		m_Modules.insert( std::upper_bound( m_Modules.begin(), m_Modules.end(), pModule, ModuleLess ), pModule );
 
 	return true;
 }
 
+void CASModuleManager::BeginDeferredSort()
+{
+	if( m_iDeferSortCount++ == 0 && m_EventManager )
+		m_EventManager->SetDeferHookSorting( true );
+}
+
+void CASModuleManager::EndDeferredSort()
+{
+	assert( m_iDeferSortCount > 0 );
+
+	if( --m_iDeferSortCount > 0 )
+		return;
+
+	std::sort( m_Modules.begin(), m_Modules.end(), ModuleLess );
+
+	if( m_EventManager )
+		m_EventManager->SetDeferHookSorting( false );
+}
+
+void CASModuleManager::RenameModule( CASModule& module, const char* const pszModuleName )
+{
+	//The index is keyed on the name owned by the script module, which is reallocated by SetName.
+	const bool bIndexed = m_ModulesByName.erase( module.GetModuleName() ) > 0;
+
+	module.GetModule()->SetName( pszModuleName );
+
+	if( bIndexed )
+		m_ModulesByName.emplace( module.GetModuleName(), &module );
+}
+
 void CASModuleManager::RemoveModule( CASModule* pModule )
 {
 	if( !pModule )
 		return;
 
-	auto it = std::find( m_Modules.begin(), m_Modules.end(), pModule );
+	auto it = FindModule( pModule );
 
 	if( it == m_Modules.end() )
 		return;
@@ -295,10 +1035,12 @@ void CASModuleManager::RemoveModule( CASModule* pModule )
 		m_EventManager->UnhookModuleFunctions( pModule );
 	}
 
-	( *it )->Discard();
-	( *it )->Release();
+	m_ModulesByName.erase( pModule->GetModuleName() );
 
 	m_Modules.erase( it );
+
+	pModule->Discard();
+	pModule->Release();
 }
 
 void CASModuleManager::RemoveModule( const char* const pszModuleName )
@@ -308,19 +1050,13 @@ void CASModuleManager::RemoveModule( const char* const pszModuleName )
 	if( !pszModuleName )
 		return;
 
-	auto it = std::find_if( m_Modules.begin(), m_Modules.end(), ModuleEqualByName( pszModuleName ) );
-
-	if( it == m_Modules.end() )
-		return;
-
-	( *it )->Discard();
-	( *it )->Release();
-
-	m_Modules.erase( it );
+	RemoveModule( FindModuleByName( pszModuleName ) );
 }
 
 void CASModuleManager::Clear()
 {
+	m_ModulesByName.clear();
+
 	for( auto pModule : m_Modules )
 	{
 		pModule->Discard();
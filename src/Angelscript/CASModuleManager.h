@@ -1,7 +1,10 @@
 #ifndef ANGELSCRIPT_CASMODULEMANAGER_H
 #define ANGELSCRIPT_CASMODULEMANAGER_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
 #include <unordered_map>
 #include <vector>
@@ -10,11 +13,18 @@
 
 #include "util/StringUtils.h"
 
+#include "CASBytecodeCache.h"
+#include "CASIncludeCache.h"
+#include "CASModule.h"
 #include "CASModuleDescriptor.h"
+#include "CASModuleMemory.h"
 
+class CASAsyncModuleBuild;
 class CASEventManager;
 class CASModule;
+class CScriptBuilder;
 class IASModuleBuilder;
+class IASModuleReloadHandler;
 class IASModuleUserData;
 
 /**
@@ -23,14 +33,117 @@ class IASModuleUserData;
 *	@{
 */
 
+/**
+*	A single module to build with CASModuleManager::BuildModules.
+*/
+struct CASModuleBuildRequest final
+{
+	/**
+	*	Descriptor to use.
+	*/
+	const CASModuleDescriptor* pDescriptor;
+
+	/**
+	*	Name of the module. Must be unique.
+	*/
+	const char* pszModuleName;
+
+	/**
+	*	Builder to use.
+	*/
+	IASModuleBuilder* pBuilder;
+
+	/**
+	*	Optional. User data to associate with the module. Will be released if the module failed to build.
+	*/
+	IASModuleUserData* pUserData;
+};
+
+/**
+*	Result of CASModuleManager::ReloadChanged.
+*/
+struct CASModuleReloadResult final
+{
+	/**
+	*	Modules that were rebuilt.
+	*/
+	std::vector<std::string> Reloaded;
+
+	/**
+	*	Modules whose files are unchanged, or that the handler chose not to rebuild.
+	*/
+	std::vector<std::string> Skipped;
+
+	/**
+	*	Modules that changed but failed to rebuild. These are left as they were.
+	*/
+	std::vector<std::string> Failed;
+};
+
+/**
+*	Memory usage of a single module, as reported by CASModuleManager::GetMemoryReport.
+*	Live memory is only available if memory tracking is installed.
+*/
+struct CASModuleMemoryReport final
+{
+	/**
+	*	Name of the module.
+	*/
+	std::string szModuleName;
+
+	/**
+	*	Size of the module's bytecode and global variables after it was built.
+	*/
+	size_t uiBytecodeSize = 0;
+	size_t uiGlobalSize = 0;
+
+	/**
+	*	Memory currently allocated by the module's scripts, and the most it has had allocated at once.
+	*/
+	size_t uiLiveBytes = 0;
+	size_t uiLiveAllocations = 0;
+	size_t uiPeakBytes = 0;
+
+	/**
+	*	Soft quota for live memory. 0 if there is no quota.
+	*/
+	size_t uiQuota = 0;
+	bool bQuotaExceeded = false;
+};
+
 /**
 *	Manages a list of module descriptors and modules.
 */
 class CASModuleManager final
 {
 private:
+	friend class CASAsyncModuleBuild;
+
+	/**
+	*	Result of compiling a module.
+	*/
+	enum class CompileResult
+	{
+		/**
+		*	The builder stopped the build before it was compiled. The script module has been discarded.
+		*/
+		ABORTED,
+
+		/**
+		*	The module failed to compile.
+		*/
+		FAILED,
+
+		/**
+		*	The module was compiled or loaded from the bytecode cache.
+		*/
+		SUCCESS
+	};
+
 	typedef std::unordered_map<const char*, std::unique_ptr<CASModuleDescriptor>, as::Hash_C_String<const char*>, as::EqualTo_C_String<const char*>> Descriptors_t;
 	typedef std::vector<CASModule*> Modules_t;
+	typedef std::unordered_map<const char*, CASModule*, as::Hash_C_String<const char*>, as::EqualTo_C_String<const char*>> ModulesByName_t;
+	typedef std::unordered_map<std::string, uint64_t> FileHashes_t;
 
 public:
 	/**
@@ -55,6 +168,42 @@ public:
 	*/
 	CASEventManager* GetEventManager() { return m_EventManager.get(); }
 
+	/**
+	*	@return The bytecode cache, if it is enabled.
+	*/
+	CASBytecodeCache* GetBytecodeCache() { return m_BytecodeCache.get(); }
+
+	/**
+	*	Enables the persistent bytecode cache. Modules built after this call are loaded from the cache if their sources and the registered API are unchanged.
+	*	If the cache is already enabled, it is replaced.
+	*	@param pszDirectory Directory to store cache files in.
+	*	@return The cache.
+	*/
+	CASBytecodeCache* EnableBytecodeCache( const char* const pszDirectory );
+
+	/**
+	*	Disables the bytecode cache. Existing cache files are left alone.
+	*/
+	void DisableBytecodeCache();
+
+	/**
+	*	@return The include cache, if it is enabled.
+	*/
+	CASIncludeCache* GetIncludeCache() { return m_IncludeCache.get(); }
+
+	/**
+	*	Enables the include cache. Files added to modules built after this call are loaded and preprocessed once, and shared between modules.
+	*	This applies to files added with CScriptBuilder::AddSectionFromFile, including files that builders add for includes.
+	*	If the cache is already enabled, it is left as it is.
+	*	@return The cache.
+	*/
+	CASIncludeCache* EnableIncludeCache();
+
+	/**
+	*	Disables the include cache and frees its entries.
+	*/
+	void DisableIncludeCache();
+
 	/**
 	*	Finds a descriptor by name.
 	*	@param pszName Name of the descriptor. Case sensitive.
@@ -78,9 +227,11 @@ public:
 	*	@param pszModuleName Name of the module. Must be unique.
 	*	@param builder Builder to use.
 	*	@param pUserData Optional. User data to associate with the module. Will be released if the module failed to build.
+	*	@param pStats Optional. Receives statistics about the build, also if it failed. Successfully built modules also store these.
 	*	@return On successful build, the module. Otherwise, null.
 	*/
-	CASModule* BuildModule( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData = nullptr );
+	CASModule* BuildModule( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData = nullptr,
+							CASModuleBuildStats* pStats = nullptr );
 
 	/**
 	*	Builds a module using the given descriptor.
@@ -88,9 +239,45 @@ public:
 	*	@param pszModuleName Name of the module. Must be unique.
 	*	@param builder Builder to use.
 	*	@param pUserData Optional. User data to associate with the module. Will be released if the module failed to build.
+	*	@param pStats Optional. Receives statistics about the build, also if it failed. Successfully built modules also store these.
 	*	@return On successful build, the module. Otherwise, null.
 	*/
-	CASModule* BuildModule( const char* const pszName, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData = nullptr );
+	CASModule* BuildModule( const char* const pszName, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData = nullptr,
+							CASModuleBuildStats* pStats = nullptr );
+
+	/**
+	*	Builds a batch of modules. The module list and event hooks are sorted once after all modules have been built,
+	*	instead of after every module and hook that is added.
+	*	A failure to build one module does not stop the others from being built.
+	*	@param pRequests Modules to build.
+	*	@param uiCount Number of modules to build.
+	*	@return For each request, the module if it was built successfully, null otherwise.
+	*/
+	std::vector<CASModule*> BuildModules( const CASModuleBuildRequest* pRequests, const size_t uiCount );
+
+	/**
+	*	@copydoc BuildModules( const CASModuleBuildRequest* pRequests, const size_t uiCount )
+	*/
+	std::vector<CASModule*> BuildModules( const std::vector<CASModuleBuildRequest>& requests )
+	{
+		return BuildModules( requests.data(), requests.size() );
+	}
+
+	/**
+	*	Starts building a module on a worker thread.
+	*	The builder's DefineWords, AddScripts, IncludeScript and PreBuild methods are called on the worker thread.
+	*	Compiling is serialized with other builds. Call CASAsyncModuleBuild::Finish on this manager's thread to add the module.
+	*	The bytecode and include caches must not be enabled or disabled while asynchronous builds are pending.
+	*	Builders can't use zero copy loading (see CScriptBuilder::SetUseMappedFiles) while asynchronous builds are running, it is blocked for all builds until they're done.
+	*	@param descriptor Descriptor to use.
+	*	@param pszModuleName Name of the module.
+	*	@param builder Builder to use. Must remain valid until the build has been finished or destroyed.
+	*	@param pUserData Optional. User data to associate with the module. Will be released if the module failed to build.
+	*	@param bReplaceExisting If a module with this name exists when the build is finished, whether to replace it. Otherwise the new module is discarded.
+	*	@return Handle to the build, or null if the build could not be started.
+	*/
+	std::unique_ptr<CASAsyncModuleBuild> BuildModuleAsync( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder,
+														   IASModuleUserData* pUserData = nullptr, const bool bReplaceExisting = false );
 
 private:
 	/**
@@ -99,9 +286,127 @@ private:
 	*	@param pszModuleName Name of the module. Must be unique.
 	*	@param builder Builder to use.
 	*	@param pUserData Optional. User data to associate with the module. Will be released if the module failed to build.
+	*	@param pStats Optional. Receives statistics about the build, also if it failed. Successfully built modules also store these.
 	*	@return On successful build, the module. Otherwise, null.
 	*/
-	CASModule* BuildModuleInternal( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData = nullptr );
+	CASModule* BuildModuleInternal( const CASModuleDescriptor& descriptor, const char* const pszModuleName, IASModuleBuilder& builder, IASModuleUserData* pUserData = nullptr,
+							CASModuleBuildStats* pStats = nullptr );
+
+	/**
+	*	Creates the script module, gathers its sources and compiles it. Safe to call from a worker thread.
+	*	@param descriptor Descriptor to use.
+	*	@param pszModuleName Name of the module, used for the bytecode cache.
+	*	@param pszScriptModuleName Name to give the script module. Can differ from pszModuleName to avoid replacing an existing module.
+	*	@param builder Builder to use.
+	*	@param scriptBuilder Script builder that will contain the module.
+	*	@param dependencies Receives the sections that went into the module.
+	*	@param stats Receives the timings of each stage and the size of the sources.
+	*	@return Result of the compilation.
+	*/
+	CompileResult CompileModule( const CASModuleDescriptor& descriptor, const char* const pszModuleName, const char* const pszScriptModuleName,
+								 IASModuleBuilder& builder, CScriptBuilder& scriptBuilder, std::vector<CASModuleDependency>& dependencies,
+								 CASModuleBuildStats& stats );
+
+	/**
+	*	Finishes building a module: creates the module, lets the builder evaluate it and adds it to this manager.
+	*	Takes ownership of the builder's script module and the user data. Both are released if the module is not kept.
+	*	@param descriptor Descriptor to use.
+	*	@param scriptBuilder Script builder that contains the module.
+	*	@param pBuilder Optional. Builder whose PostBuild is called.
+	*	@param bSuccess Whether the module was built successfully.
+	*	@param pUserData Optional. User data to associate with the module.
+	*	@param stats Statistics for this build. The PostBuild time and module contents are added, then the statistics are recorded.
+	*	@return On success, the module. Otherwise, null.
+	*/
+	CASModule* FinishBuild( const CASModuleDescriptor& descriptor, CScriptBuilder& scriptBuilder, IASModuleBuilder* pBuilder, const bool bSuccess, IASModuleUserData* pUserData,
+							CASModuleBuildStats& stats );
+
+	/**
+	*	Adds the statistics of a build to the totals.
+	*/
+	void RecordBuildStats( const CASModuleBuildStats& stats );
+
+public:
+	/**
+	*	@return The combined statistics of all builds since the last reset, including failed builds.
+	*/
+	const CASModuleBuildStats& GetTotalBuildStats() const { return m_TotalBuildStats; }
+
+	/**
+	*	@return The number of builds that make up the total statistics.
+	*/
+	size_t GetBuildCount() const { return m_uiBuildCount; }
+
+	/**
+	*	Resets the total build statistics.
+	*/
+	void ResetBuildStats();
+
+	/**
+	*	@return The memory usage of every module, in module order.
+	*/
+	std::vector<CASModuleMemoryReport> GetMemoryReport() const;
+
+	/**
+	*	Logs the memory usage of every module.
+	*/
+	void LogMemoryReport() const;
+
+	/**
+	*	@return The quota applied to modules when they are built. 0 if there is no quota.
+	*/
+	size_t GetDefaultModuleMemoryQuota() const { return m_uiDefaultMemoryQuota; }
+
+	/**
+	*	Sets the quota applied to modules when they are built. Existing modules keep their quota.
+	*	Has no effect unless memory tracking is installed.
+	*	@param uiQuota Quota, in bytes. 0 to remove the quota.
+	*	@param mode What to do when a module exceeds its quota.
+	*/
+	void SetDefaultModuleMemoryQuota( const size_t uiQuota, const as::MemoryQuotaMode mode = as::MemoryQuotaMode::LOG )
+	{
+		m_uiDefaultMemoryQuota = uiQuota;
+		m_DefaultMemoryQuotaMode = mode;
+	}
+
+public:
+	/**
+	*	Loads all modules in a bundle created by CASModuleBundleWriter.
+	*	The bundle is mapped into memory and each module's bytecode is loaded straight from the mapping.
+	*	Descriptors referenced by the bundle must have been added already, and the engine must have the same API as the one that compiled the bundle.
+	*	@param pszFilename Name of the bundle file.
+	*	@param pBuilder Optional. Builder whose PostBuild is called for each module. Bundles contain no sources, so metadata is not available.
+	*	@return Number of modules that were loaded.
+	*/
+	size_t LoadModuleBundle( const char* const pszFilename, IASModuleBuilder* pBuilder = nullptr );
+
+	/**
+	*	Checks whether any of the files that a module was built from have changed since it was built.
+	*	Files whose modification time and size are unchanged are not read.
+	*	@param module Module to check.
+	*	@return Whether the module should be rebuilt.
+	*/
+	bool HasModuleChanged( const CASModule& module ) const;
+
+	/**
+	*	Rebuilds a module. The existing module is only removed if the new module was built successfully.
+	*	@param module Module to rebuild.
+	*	@param builder Builder to use.
+	*	@param pUserData Optional. User data to associate with the new module. Will be released if the module failed to build.
+	*	@return On success, the new module. Otherwise, null.
+	*/
+	CASModule* ReloadModule( CASModule& module, IASModuleBuilder& builder, IASModuleUserData* pUserData = nullptr );
+
+	/**
+	*	Rebuilds every module whose files have changed since it was built. Unchanged modules keep their hooks and timers.
+	*	Sections added from memory are not checked, since they are provided by builders.
+	*	@param handler Handler that provides builders for changed modules.
+	*	@return Which modules were reloaded, skipped or failed to reload.
+	*/
+	CASModuleReloadResult ReloadChanged( IASModuleReloadHandler& handler );
+
+private:
+	bool HasModuleChanged( const CASModule& module, FileHashes_t& fileHashes ) const;
 
 public:
 	/**
@@ -141,6 +446,28 @@ private:
 	*/
 	bool AddModule( CASModule* pModule );
 
+	/**
+	*	Finds a module in the module list.
+	*	@param pModule Module to find.
+	*	@return Iterator pointing to the module, or the end of the list if this manager doesn't contain the module.
+	*/
+	Modules_t::iterator FindModule( const CASModule* pModule );
+
+	/**
+	*	Starts deferring sorting of the module list and event hooks. Calls may be nested.
+	*/
+	void BeginDeferredSort();
+
+	/**
+	*	Ends deferring sorting. When the outermost call ends, everything that was deferred is sorted.
+	*/
+	void EndDeferredSort();
+
+	/**
+	*	Renames a module, keeping the name index up to date.
+	*/
+	void RenameModule( CASModule& module, const char* const pszModuleName );
+
 public:
 	/**
 	*	Removes a module. The module may not be destroyed immediately if there are active references held to it.
@@ -168,8 +495,42 @@ private:
 
 	as::DescriptorID_t m_NextDescriptorID = as::FIRST_DESCRIPTOR_ID;
 
+	/**
+	*	Modules sorted by ModuleLess. Inserts use a binary search to keep the order.
+	*	While sorting is deferred, modules are appended instead.
+	*/
 	Modules_t m_Modules;
 
+	int m_iDeferSortCount = 0;
+
+	/**
+	*	Index of modules by name. Keys are owned by the script modules.
+	*/
+	ModulesByName_t m_ModulesByName;
+
+	std::unique_ptr<CASBytecodeCache> m_BytecodeCache;
+
+	std::unique_ptr<CASIncludeCache> m_IncludeCache;
+
+	/**
+	*	Serializes compilation between this thread and asynchronous builds.
+	*/
+	std::mutex m_CompileMutex;
+
+	unsigned int m_uiAsyncBuildCount = 0;
+
+	/**
+	*	Number of asynchronous builds whose scripts are still being added or compiled.
+	*	Zero copy loading is blocked while this is not zero, since it changes an engine wide property.
+	*/
+	std::atomic<unsigned int> m_uiRunningAsyncBuilds{ 0 };
+
+	CASModuleBuildStats m_TotalBuildStats;
+	size_t m_uiBuildCount = 0;
+
+	size_t m_uiDefaultMemoryQuota = 0;
+	as::MemoryQuotaMode m_DefaultMemoryQuotaMode = as::MemoryQuotaMode::LOG;
+
 private:
 	CASModuleManager( const CASModuleManager& ) = delete;
 	CASModuleManager& operator=( const CASModuleManager& ) = delete;
@@ -0,0 +1,263 @@
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+#include <angelscript.h>
+
+#include "util/ASLogging.h"
+
+#include "CASModuleMemory.h"
+
+namespace
+{
+/*
+*	Stored in front of every allocation so frees can be attributed to the module that made the allocation.
+*/
+struct alignas( alignof( std::max_align_t ) ) AllocHeader final
+{
+	CASModuleMemory* pMemory;
+	size_t uiSize;
+};
+
+bool g_bInstalled = false;
+
+/*
+*	Maps script modules to their accounting.
+*	A separate lock is used, since the engine's lock may be held while allocating. Module user data can't be used for the same reason.
+*/
+std::mutex g_ModulesMutex;
+std::unordered_map<const asIScriptModule*, CASModuleMemory*> g_Modules;
+
+/*
+*	Number of modules in g_Modules. Allocations skip all attribution while this is 0.
+*/
+std::atomic<size_t> g_uiModuleCount{ 0 };
+
+/*
+*	Set while an allocation is being attributed. Getting the active context can allocate thread local data.
+*/
+thread_local bool t_bAttributing = false;
+
+/*
+*	Gets the module to charge for allocations made by a function.
+*	Methods are charged to the module that declared their type, so methods of shared types are charged to the module that owns the type.
+*/
+const asIScriptModule* GetChargedModule( const asIScriptFunction& function )
+{
+	if( auto pType = function.GetObjectType() )
+	{
+		if( auto pModule = pType->GetModule() )
+			return pModule;
+	}
+
+	return function.GetModule();
+}
+
+/*
+*	Attributes an allocation to the module that is currently executing.
+*	The allocation is made while holding the lock so the accounting can't be released in between.
+*/
+CASModuleMemory* AttributeAllocation( asIScriptContext& context, const size_t uiSize, bool& bWithinQuota )
+{
+	bWithinQuota = true;
+
+	auto pFunction = context.GetFunction( 0 );
+
+	if( !pFunction )
+		return nullptr;
+
+	auto pModule = GetChargedModule( *pFunction );
+
+	if( !pModule )
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock( g_ModulesMutex );
+
+	auto it = g_Modules.find( pModule );
+
+	if( it == g_Modules.end() )
+		return nullptr;
+
+	bWithinQuota = it->second->Allocate( uiSize );
+
+	return it->second;
+}
+
+void* TrackedAlloc( size_t uiSize )
+{
+	CASModuleMemory* pMemory = nullptr;
+
+	if( g_uiModuleCount.load( std::memory_order_relaxed ) > 0 && !t_bAttributing )
+	{
+		t_bAttributing = true;
+
+		auto pContext = asGetActiveContext();
+
+		if( pContext && pContext->GetState() == asEXECUTION_ACTIVE )
+		{
+			bool bWithinQuota;
+
+			pMemory = AttributeAllocation( *pContext, uiSize, bWithinQuota );
+
+			//The engine doesn't check every allocation for failure, and exceptions can only be set from application functions.
+			//Aborting only sets a flag that the context checks the next time it calls a function or reaches a suspend point.
+			if( !bWithinQuota )
+				pContext->Abort();
+		}
+
+		t_bAttributing = false;
+	}
+
+	auto pHeader = reinterpret_cast<AllocHeader*>( malloc( sizeof( AllocHeader ) + uiSize ) );
+
+	if( !pHeader )
+	{
+		if( pMemory )
+			pMemory->Free( uiSize );
+
+		return nullptr;
+	}
+
+	//Frees are charged to the accounting that was charged here, even if the module has been discarded since.
+	pHeader->pMemory = pMemory;
+	pHeader->uiSize = uiSize;
+
+	return pHeader + 1;
+}
+
+void TrackedFree( void* pBlock )
+{
+	if( !pBlock )
+		return;
+
+	auto pHeader = reinterpret_cast<AllocHeader*>( pBlock ) - 1;
+
+	if( pHeader->pMemory )
+		pHeader->pMemory->Free( pHeader->uiSize );
+
+	free( pHeader );
+}
+}
+
+namespace as
+{
+bool InstallMemoryTracking()
+{
+	if( g_bInstalled )
+		return true;
+
+	if( asSetGlobalMemoryFunctions( &::TrackedAlloc, &::TrackedFree ) < 0 )
+		return false;
+
+	g_bInstalled = true;
+
+	return true;
+}
+
+bool IsMemoryTrackingInstalled()
+{
+	return g_bInstalled;
+}
+}
+
+CASModuleMemory* CASModuleMemory::Create( const asIScriptModule& module )
+{
+	if( !as::IsMemoryTrackingInstalled() )
+		return nullptr;
+
+	auto pMemory = new CASModuleMemory( module );
+
+	std::lock_guard<std::mutex> lock( g_ModulesMutex );
+
+	g_Modules[ &module ] = pMemory;
+	g_uiModuleCount.store( g_Modules.size(), std::memory_order_relaxed );
+
+	return pMemory;
+}
+
+CASModuleMemory::CASModuleMemory( const asIScriptModule& module )
+	: m_pModule( &module )
+{
+}
+
+void CASModuleMemory::Release()
+{
+	{
+		std::lock_guard<std::mutex> lock( g_ModulesMutex );
+
+		Unregister();
+
+		m_pModule = nullptr;
+	}
+
+	RemoveReference();
+}
+
+void CASModuleMemory::SetQuota( const size_t uiQuota, const as::MemoryQuotaMode mode )
+{
+	m_uiQuota.store( uiQuota, std::memory_order_relaxed );
+	m_QuotaMode.store( mode, std::memory_order_relaxed );
+
+	if( !uiQuota || GetLiveBytes() <= uiQuota )
+		m_bQuotaExceeded.store( false, std::memory_order_relaxed );
+}
+
+bool CASModuleMemory::Allocate( const size_t uiSize )
+{
+	const size_t uiLiveBytes = m_uiLiveBytes.fetch_add( uiSize, std::memory_order_relaxed ) + uiSize;
+
+	m_uiLiveAllocations.fetch_add( 1, std::memory_order_relaxed );
+	m_uiRefCount.fetch_add( 1, std::memory_order_relaxed );
+
+	size_t uiPeak = m_uiPeakBytes.load( std::memory_order_relaxed );
+
+	while( uiLiveBytes > uiPeak && !m_uiPeakBytes.compare_exchange_weak( uiPeak, uiLiveBytes, std::memory_order_relaxed ) )
+	{
+	}
+
+	const size_t uiQuota = GetQuota();
+
+	if( !uiQuota || uiLiveBytes <= uiQuota )
+		return true;
+
+	const bool bAbort = GetQuotaMode() == as::MemoryQuotaMode::ABORT;
+
+	//Only log when the quota is first exceeded.
+	if( !m_bQuotaExceeded.exchange( true, std::memory_order_relaxed ) )
+	{
+		as::Critical( "Module \"%s\" exceeded its memory quota of %u bytes%s\n",
+			m_pModule ? m_pModule->GetName() : "", static_cast<unsigned int>( uiQuota ), bAbort ? ", aborting script" : "" );
+	}
+
+	return !bAbort;
+}
+
+void CASModuleMemory::Free( const size_t uiSize )
+{
+	const size_t uiLiveBytes = m_uiLiveBytes.fetch_sub( uiSize, std::memory_order_relaxed ) - uiSize;
+
+	m_uiLiveAllocations.fetch_sub( 1, std::memory_order_relaxed );
+
+	if( m_bQuotaExceeded.load( std::memory_order_relaxed ) && uiLiveBytes <= GetQuota() )
+		m_bQuotaExceeded.store( false, std::memory_order_relaxed );
+
+	RemoveReference();
+}
+
+void CASModuleMemory::Unregister()
+{
+	auto it = g_Modules.find( m_pModule );
+
+	if( it != g_Modules.end() && it->second == this )
+	{
+		g_Modules.erase( it );
+		g_uiModuleCount.store( g_Modules.size(), std::memory_order_relaxed );
+	}
+}
+
+void CASModuleMemory::RemoveReference()
+{
+	if( m_uiRefCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+		delete this;
+}
@@ -0,0 +1,157 @@
+#ifndef ANGELSCRIPT_CASMODULEMEMORY_H
+#define ANGELSCRIPT_CASMODULEMEMORY_H
+
+#include <atomic>
+#include <cstddef>
+
+class asIScriptModule;
+
+/**
+*	@addtogroup ASModule
+*
+*	@{
+*/
+
+namespace as
+{
+/**
+*	What to do when a module exceeds its memory quota.
+*/
+enum class MemoryQuotaMode
+{
+	/**
+	*	Log a message when the quota is exceeded, but allow the allocation.
+	*/
+	LOG,
+
+	/**
+	*	Log a message and abort the context that made the allocation. The context stops with asEXECUTION_ABORTED
+	*	the next time it calls a function or reaches a suspend point, not inside the allocation.
+	*	The allocation itself still succeeds, since the engine does not handle failed allocations everywhere.
+	*/
+	ABORT
+};
+
+/**
+*	Installs memory functions that attribute allocations to the module that is executing when the allocation is made.
+*	Must be called before any script engine is created, since memory allocated with other functions can't be freed by these.
+*	Once installed, memory tracking stays installed for the remainder of the process.
+*	@return Whether memory tracking is installed.
+*/
+bool InstallMemoryTracking();
+
+/**
+*	@return Whether memory tracking has been installed.
+*/
+bool IsMemoryTrackingInstalled();
+}
+
+/**
+*	Memory accounting for a single module.
+*	An allocation is attributed to a module if a context is executing one of its functions when the allocation is made.
+*	Methods are attributed to the module that declared their type, which matters for shared types.
+*	The engine doesn't tell the memory functions what type is being allocated, so the instance of a script class
+*	is charged to the module whose code created it. Memory allocated by its constructor and methods is charged to the type's module.
+*	Frees are charged to the accounting that was charged for the allocation.
+*	Accounting continues after the module is discarded, until all of its allocations have been freed.
+*/
+class CASModuleMemory final
+{
+public:
+	/**
+	*	Creates accounting for a module. Subsequent allocations made by the module's functions are attributed to it.
+	*	@param module Script module.
+	*	@return Memory accounting, or null if memory tracking isn't installed.
+	*/
+	static CASModuleMemory* Create( const asIScriptModule& module );
+
+	/**
+	*	Stops attributing allocations to the module. The accounting is destroyed when all of its allocations have been freed.
+	*/
+	void Release();
+
+	/**
+	*	@return The number of bytes currently allocated by the module.
+	*/
+	size_t GetLiveBytes() const { return m_uiLiveBytes.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return The number of allocations currently held by the module.
+	*/
+	size_t GetLiveAllocations() const { return m_uiLiveAllocations.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return The largest number of bytes the module has had allocated at once.
+	*/
+	size_t GetPeakBytes() const { return m_uiPeakBytes.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return The quota, in bytes. 0 if there is no quota.
+	*/
+	size_t GetQuota() const { return m_uiQuota.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return What happens when the quota is exceeded.
+	*/
+	as::MemoryQuotaMode GetQuotaMode() const { return m_QuotaMode.load( std::memory_order_relaxed ); }
+
+	/**
+	*	Sets the soft quota.
+	*	@param uiQuota Quota, in bytes. 0 to remove the quota.
+	*	@param mode What to do when the quota is exceeded.
+	*/
+	void SetQuota( const size_t uiQuota, const as::MemoryQuotaMode mode = as::MemoryQuotaMode::LOG );
+
+	/**
+	*	@return Whether the module is currently over its quota.
+	*/
+	bool IsQuotaExceeded() const { return m_bQuotaExceeded.load( std::memory_order_relaxed ); }
+
+	/**
+	*	Attributes an allocation to this module.
+	*	@param uiSize Size of the allocation.
+	*	@return Whether the allocation is allowed. False if it exceeds the quota and the quota mode is ABORT.
+	*/
+	bool Allocate( const size_t uiSize );
+
+	/**
+	*	Removes an allocation from this module.
+	*	@param uiSize Size of the allocation.
+	*/
+	void Free( const size_t uiSize );
+
+private:
+	CASModuleMemory( const asIScriptModule& module );
+	~CASModuleMemory() = default;
+
+	/**
+	*	Stops attributing allocations to this module. The modules lock must be held.
+	*/
+	void Unregister();
+
+	void RemoveReference();
+
+private:
+	const asIScriptModule* m_pModule;
+
+	std::atomic<size_t> m_uiLiveBytes{ 0 };
+	std::atomic<size_t> m_uiLiveAllocations{ 0 };
+	std::atomic<size_t> m_uiPeakBytes{ 0 };
+
+	std::atomic<size_t> m_uiQuota{ 0 };
+	std::atomic<as::MemoryQuotaMode> m_QuotaMode{ as::MemoryQuotaMode::LOG };
+	std::atomic<bool> m_bQuotaExceeded{ false };
+
+	/**
+	*	One reference for the module, and one for each live allocation.
+	*/
+	std::atomic<size_t> m_uiRefCount{ 1 };
+
+private:
+	CASModuleMemory( const CASModuleMemory& ) = delete;
+	CASModuleMemory& operator=( const CASModuleMemory& ) = delete;
+};
+
+/** @} */
+
+#endif //ANGELSCRIPT_CASMODULEMEMORY_H
@@ -42,6 +42,12 @@ public:
 	*/
 	virtual bool GetMessageCallback( asSFuncPtr& outFuncPtr, void*& pOutObj, asDWORD& outCallConv );
 
+	/**
+	*	@return Whether to install memory functions that track memory usage per module.
+	*	@see as::InstallMemoryTracking
+	*/
+	virtual bool UseMemoryTracking() { return false; }
+
 	/**
 	*	@return Whether to create an event manager.
 	*/
@@ -0,0 +1,48 @@
+#ifndef ANGELSCRIPT_IASMODULERELOADHANDLER_H
+#define ANGELSCRIPT_IASMODULERELOADHANDLER_H
+
+#include "util/ASPlatform.h"
+
+class CASModule;
+class IASModuleBuilder;
+class IASModuleUserData;
+
+/**
+*	@addtogroup ASModule
+*
+*	@{
+*/
+
+/**
+*	Interface used by CASModuleManager::ReloadChanged to rebuild modules whose sources have changed.
+*/
+class IASModuleReloadHandler
+{
+public:
+	/**
+	*	Destructor.
+	*/
+	virtual ~IASModuleReloadHandler() = 0;
+
+	/**
+	*	Gets the builder to rebuild a module with.
+	*	@param module Module whose sources have changed.
+	*	@return Builder to use. Must remain valid until ReloadChanged returns. Return null to leave the module as it is.
+	*/
+	virtual IASModuleBuilder* GetBuilder( CASModule& module ) = 0;
+
+	/**
+	*	Creates the user data for a rebuilt module.
+	*	@param oldModule Module that is being rebuilt. It is removed if the rebuild succeeds.
+	*	@return User data to associate with the rebuilt module, or null.
+	*/
+	virtual IASModuleUserData* CreateUserData( CASModule& ASUNREFERENCED( oldModule ) ) { return nullptr; }
+};
+
+inline IASModuleReloadHandler::~IASModuleReloadHandler()
+{
+}
+
+/** @} */
+
+#endif //ANGELSCRIPT_IASMODULERELOADHANDLER_H
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <angelscript.h>
 
 #include "Angelscript/CASManager.h"
@@ -8,6 +10,7 @@
 #include "Angelscript/util/ASLogging.h"
 #include "Angelscript/util/ASUtil.h"
 #include "Angelscript/util/ContextUtils.h"
+#include "Angelscript/util/StringUtils.h"
 
 #include "Angelscript/wrapper/ASCallable.h"
 #include "Angelscript/wrapper/CASArguments.h"
@@ -24,11 +27,8 @@ void CASScheduler::CScheduledFunction::Remove( asIScriptEngine& engine )
 
 	m_bRemoved = true;
 
-	if( m_pArguments )
-	{
-		delete m_pArguments;
-		m_pArguments = nullptr;
-	}
+	//Keep the storage for when the function is reused.
+	m_Arguments.Reset();
 
 	if( m_pThis )
 	{
@@ -39,6 +39,59 @@ void CASScheduler::CScheduledFunction::Remove( asIScriptEngine& engine )
 	}
 
 	as::SetRefPointer<asIScriptFunction>( m_pFunction, nullptr );
+
+	m_pScheduler = nullptr;
+}
+
+void CASScheduler::CScheduledFunction::SetNextCallTime( const float flNextCallTime )
+{
+	m_flNextCallTime = flNextCallTime;
+
+	if( m_pScheduler )
+		m_pScheduler->OnNextCallTimeChanged( *this );
+}
+
+void CASScheduler::CScheduledFunction::SetRepeatCount( const int iRepeatCount )
+{
+	//Allow 0, will cause immediate removal, or removal after the call completes
+	if( iRepeatCount < REPEAT_INF_TIMES )
+		return;
+
+	m_iRepeatCount = iRepeatCount;
+
+	if( m_pScheduler )
+		m_pScheduler->OnRepeatCountChanged( *this );
+}
+
+void CASScheduler::CScheduledFunction::Release() const
+{
+	if( InternalRelease() )
+	{
+		if( m_pPool )
+			m_pPool->FreeFunction( const_cast<CScheduledFunction*>( this ) );
+		else
+			delete this;
+	}
+}
+
+void CASScheduler::CScheduledFunction::Init( asIScriptFunction* const pFunction,
+	const float flNextCallTime, const float flRepeatTime, const int iRepeatCount,
+	void* const pThis, const int iTypeId, CASScheduler* const pScheduler, const size_t uiSequence )
+{
+	assert( pFunction );
+
+	m_pFunction = pFunction;
+	m_flNextCallTime = flNextCallTime;
+	m_flRepeatTime = flRepeatTime;
+	m_iRepeatCount = iRepeatCount;
+	m_pThis = pThis;
+	m_iTypeId = iTypeId;
+	m_pScheduler = pScheduler;
+	m_uiSequence = uiSequence;
+	m_uiHeapIndex = INVALID_HEAP_INDEX;
+	m_bRemoved = false;
+
+	pFunction->AddRef();
 }
 
 CASScheduler::CScheduledFunction::~CScheduledFunction()
@@ -55,7 +108,18 @@ CASScheduler::CASScheduler( CASModule& owningModule )
 CASScheduler::~CASScheduler()
 {
 	//Should be empty by now.
-	assert( !m_pFunctionListHead );
+	assert( m_Heap.empty() && m_ThinkList.empty() && m_CalledList.empty() );
+
+	ClearResolvedFunctions();
+
+	//Functions that scripts still hold references to free themselves when they're released.
+	for( auto pFunction : m_PooledFunctions )
+	{
+		if( pFunction->m_bInPool )
+			delete pFunction;
+		else
+			pFunction->m_pPool = nullptr;
+	}
 }
 
 void CASScheduler::SetTimeoutHandler( asIScriptGeneric* pArguments )
@@ -167,9 +231,9 @@ void CASScheduler::SetInterval( void* pThis, int iTypeId, const std::string& szF
 
 	bool bSuccess = true;
 
-	CScheduledFunction* pFunc = nullptr;
+	CScheduledFunction* pFunc = AllocateFunction();
 
-	CASArguments* pArgs = new CASArguments();
+	CASArguments* pArgs = pFunc->GetArguments();
 
 	if( ( bSuccess = pArgs->SetArguments( arguments, uiStartIndex ) ) != false )
 	{
@@ -186,7 +250,7 @@ void CASScheduler::SetInterval( void* pThis, int iTypeId, const std::string& szF
 			{
 				if( pType->GetFlags() & asOBJ_REF )
 				{
-					pFunction = as::FindFunction( *pEngine, as::CASMethodIterator( *pType ), szFunctionName, *pArgs );
+					pFunction = FindFunction( *pEngine, pType, szFunctionName, *pArgs );
 				}
 				else
 				{
@@ -201,39 +265,15 @@ void CASScheduler::SetInterval( void* pThis, int iTypeId, const std::string& szF
 		}
 		else
 		{
-			pFunction = as::FindFunction( *pEngine, as::CASFunctionIterator( *m_OwningModule.GetModule() ), szFunctionName, *pArgs );
+			pFunction = FindFunction( *pEngine, nullptr, szFunctionName, *pArgs );
 		}
 
 		if( pFunction )
 		{
-			//TODO: m_flLastTime may not be the same as the current time if Think isn't called every frame.
-
-			pFunc = new CScheduledFunction( 
-				pFunction,
-				m_flLastTime + flRepeatTime,
-				flRepeatTime,
-				iRepeatCount,
-				pThis,
-				iTypeId,
-				pArgs
-				);
-
-			if( pThis )
-				pEngine->AddRefScriptObject( pThis, pType );
-
-			//Add to either main list or thinking list
-			CScheduledFunction** ppHead = m_bThinking ? &m_pThinkListHead : &m_pFunctionListHead;
-
-			pFunc->SetNext( *ppHead );
-
-			*ppHead = pFunc;
-
-			//For the return value, so the engine doesn't release our internal ref
-			pFunc->AddRef();
+			Schedule( *pEngine, pFunc, pFunction, pThis, iTypeId, flRepeatTime, iRepeatCount );
 		}
 		else
 		{
-			delete pArgs;
 			as::Critical( "Error: CScheduler::SetInterval: could not add function '%s', function not found\n", szFunctionName.c_str() );
 			bSuccess = false;
 		}
@@ -244,37 +284,290 @@ void CASScheduler::SetInterval( void* pThis, int iTypeId, const std::string& szF
 		bSuccess = false;
 	}
 
+	if( !bSuccess )
+	{
+		//Return it to the pool.
+		pFunc->Release();
+		pFunc = nullptr;
+	}
+
 	arguments.SetReturnAddress( pFunc );
 }
 
-void CASScheduler::RemoveTimer( CScheduledFunction* pFunction )
+void CASScheduler::SetTimeoutCallbackHandler( asIScriptGeneric* pArguments )
 {
-	if( !pFunction )
+	//The following arguments are always passed before the varargs part
+
+	void* pValue = pArguments->GetArgAddress( 0 );
+	const int iTypeId = pArguments->GetArgTypeId( 0 );
+	const float flDelay = pArguments->GetArgFloat( 1 );
+
+	auto& scheduler = *reinterpret_cast<CASScheduler*>( pArguments->GetObject() );
+
+	CScheduledFunction* pFunc = nullptr;
+
+	if( auto pCallback = scheduler.GetCallbackFromValue( pValue, iTypeId ) )
+	{
+		//Always repeat only once
+		pFunc = scheduler.ScheduleCallback( pCallback, flDelay, 1, 2, pArguments );
+	}
+
+	pArguments->SetReturnAddress( pFunc );
+}
+
+void CASScheduler::SetIntervalCallbackHandler( asIScriptGeneric* pArguments )
+{
+	//The following arguments are always passed before the varargs part
+
+	void* pValue = pArguments->GetArgAddress( 0 );
+	const int iTypeId = pArguments->GetArgTypeId( 0 );
+	const float flRepeatTime = pArguments->GetArgFloat( 1 );
+	const int iRepeatCount = pArguments->GetArgDWord( 2 );
+
+	auto& scheduler = *reinterpret_cast<CASScheduler*>( pArguments->GetObject() );
+
+	CScheduledFunction* pFunc = nullptr;
+
+	if( auto pCallback = scheduler.GetCallbackFromValue( pValue, iTypeId ) )
+	{
+		pFunc = scheduler.ScheduleCallback( pCallback, flRepeatTime, iRepeatCount, 3, pArguments );
+	}
+
+	pArguments->SetReturnAddress( pFunc );
+}
+
+CASScheduler::CScheduledFunction* CASScheduler::SetTimeoutCallback( void* pValue, int iTypeId, float flDelay )
+{
+	if( auto pCallback = GetCallbackFromValue( pValue, iTypeId ) )
+		return SetTimeout( pCallback, flDelay );
+
+	return nullptr;
+}
+
+CASScheduler::CScheduledFunction* CASScheduler::SetIntervalCallback( void* pValue, int iTypeId, float flRepeatTime, int iRepeatCount )
+{
+	if( auto pCallback = GetCallbackFromValue( pValue, iTypeId ) )
+		return SetInterval( pCallback, flRepeatTime, iRepeatCount );
+
+	return nullptr;
+}
+
+CASScheduler::CScheduledFunction* CASScheduler::SetIntervalCallback_NoArgs( void* pValue, int iTypeId, float flRepeatTime )
+{
+	if( auto pCallback = GetCallbackFromValue( pValue, iTypeId ) )
+		return SetInterval( pCallback, flRepeatTime, REPEAT_INF_TIMES );
+
+	return nullptr;
+}
+
+CASScheduler::PoolStats_t CASScheduler::GetPoolStats() const
+{
+	PoolStats_t stats;
+
+	stats.uiPoolSize = m_PooledFunctions.size();
+	stats.uiFree = m_FreeFunctions.size();
+	stats.uiHighWaterMark = m_uiPoolHighWaterMark;
+	stats.uiReuseCount = m_uiPoolReuseCount;
+
+	return stats;
+}
+
+void CASScheduler::TrimPool()
+{
+	if( m_FreeFunctions.empty() )
 		return;
 
-	CScheduledFunction* pNext = m_pFunctionListHead;
-	CScheduledFunction* pLast = nullptr;
+	m_PooledFunctions.erase( std::remove_if( m_PooledFunctions.begin(), m_PooledFunctions.end(), []( const CScheduledFunction* pFunction )
+	{
+		return pFunction->m_bInPool;
+	} ), m_PooledFunctions.end() );
+
+	for( auto pFunction : m_FreeFunctions )
+	{
+		delete pFunction;
+	}
+
+	m_FreeFunctions.clear();
+}
+
+CASScheduler::CScheduledFunction* CASScheduler::AllocateFunction()
+{
+	CScheduledFunction* pFunction;
+
+	if( !m_FreeFunctions.empty() )
+	{
+		pFunction = m_FreeFunctions.back();
+		m_FreeFunctions.pop_back();
+
+		pFunction->m_bInPool = false;
+
+		//The reference count dropped to 0 when it was released.
+		pFunction->AddRef();
+
+		++m_uiPoolReuseCount;
+	}
+	else
+	{
+		pFunction = new CScheduledFunction( this );
+
+		m_PooledFunctions.push_back( pFunction );
+	}
+
+	const size_t uiInUse = m_PooledFunctions.size() - m_FreeFunctions.size();
+
+	if( uiInUse > m_uiPoolHighWaterMark )
+		m_uiPoolHighWaterMark = uiInUse;
+
+	return pFunction;
+}
+
+void CASScheduler::FreeFunction( CScheduledFunction* pFunction )
+{
+	assert( pFunction );
+	assert( pFunction->HasBeenRemoved() );
+	assert( !pFunction->m_bInPool );
+
+	//Functions that failed to schedule may still have arguments.
+	pFunction->m_Arguments.Reset();
+
+	pFunction->m_bInPool = true;
+
+	m_FreeFunctions.push_back( pFunction );
+}
+
+CASScheduler::CScheduledFunction* CASScheduler::Schedule( asIScriptEngine& engine, CScheduledFunction* pFunc, asIScriptFunction* pFunction, void* pThis, const int iTypeId,
+	const float flRepeatTime, const int iRepeatCount )
+{
+	//TODO: m_flLastTime may not be the same as the current time if Think isn't called every frame.
+
+	pFunc->Init( 
+		pFunction,
+		m_flLastTime + flRepeatTime,
+		flRepeatTime,
+		iRepeatCount,
+		pThis,
+		iTypeId,
+		this,
+		m_uiNextSequence++
+		);
+
+	if( pThis )
+		engine.AddRefScriptObject( pThis, engine.GetTypeInfoById( iTypeId ) );
+
+	//Add to either the heap or the thinking list
+	if( m_bThinking )
+		m_ThinkList.push_back( pFunc );
+	else
+		HeapPush( pFunc );
+
+	//For the return value, so the engine doesn't release our internal ref
+	pFunc->AddRef();
+
+	return pFunc;
+}
+
+CASScheduler::CScheduledFunction* CASScheduler::ScheduleCallback( asIScriptFunction* pCallback, float flRepeatTime, int iRepeatCount, asUINT uiStartIndex, asIScriptGeneric* pArguments )
+{
+	assert( pCallback );
+
+	if( !pCallback )
+		return nullptr;
+
+	if( flRepeatTime < 0.0f )
+	{
+		as::Critical( "Error: CScheduler::SetInterval: negative repeat time or delay is not allowed!\n" );
+		return nullptr;
+	}
+
+	if( !iRepeatCount || iRepeatCount < CASScheduler::REPEAT_INF_TIMES )
+	{
+		as::Critical(
+			"Error: CScheduler::SetInterval: can only add function '%s' if repeat count is positive and non-zero, or REPEAT_INFINITE_TIMES!\n",
+			pCallback->GetName() );
+		return nullptr;
+	}
 
 	auto& engine = *m_OwningModule.GetModule()->GetEngine();
 
-	bool bRemoved = false;
+	//Delegates are stored as the method and the object, like methods scheduled by name.
+	asIScriptFunction* pFunction = pCallback;
+	void* pThis = nullptr;
+	int iTypeId = 0;
 
-	while( pNext )
+	if( auto pDelegate = pCallback->GetDelegateFunction() )
 	{
-		if( pNext == pFunction )
-		{
-			//If we're currently executing this function, remove it later.
-			if( m_pCurrentFunction == pNext )
-				m_bShouldRemove = true;
-			else
-				RemoveFunction( engine, pLast, pNext );
+		pFunction = pDelegate;
+		pThis = pCallback->GetDelegateObject();
+		iTypeId = pCallback->GetDelegateObjectType()->GetTypeId();
+	}
 
-			bRemoved = true;
-			break;
-		}
+	auto pFunc = AllocateFunction();
 
-		pLast = pNext;
-		pNext = pNext->GetNext();
+	if( pArguments && !pFunc->GetArguments()->SetArguments( *pArguments, uiStartIndex ) )
+	{
+		pFunc->Release();
+		as::Critical( "Error: CScheduler::SetInterval: could not add function '%s', failed to parse arguments\n", pFunction->GetName() );
+		return nullptr;
+	}
+
+	//The function is already known, so only the arguments need to be checked.
+	if( !as::FindFunction( engine, as::CASSingleFunctionIterator( *pFunction ), pFunction->GetName(), *pFunc->GetArguments() ) )
+	{
+		pFunc->Release();
+		as::Critical( "Error: CScheduler::SetInterval: could not add function '%s', arguments do not match its parameters\n", pFunction->GetName() );
+		return nullptr;
+	}
+
+	return Schedule( engine, pFunc, pFunction, pThis, iTypeId, flRepeatTime, iRepeatCount );
+}
+
+asIScriptFunction* CASScheduler::GetCallbackFromValue( void* pValue, int iTypeId ) const
+{
+	auto& engine = *m_OwningModule.GetModule()->GetEngine();
+
+	auto pType = engine.GetTypeInfoById( iTypeId );
+
+	if( !pType || !( pType->GetFlags() & asOBJ_FUNCDEF ) )
+	{
+		as::Critical( "Error: CScheduler::SetInterval: object is not a function or delegate!\n" );
+		return nullptr;
+	}
+
+	if( pValue && ( iTypeId & asTYPEID_OBJHANDLE ) )
+		pValue = *reinterpret_cast<void**>( pValue );
+
+	if( !pValue )
+	{
+		as::Critical( "Error: CScheduler::SetInterval: null function passed!\n" );
+		return nullptr;
+	}
+
+	return reinterpret_cast<asIScriptFunction*>( pValue );
+}
+
+void CASScheduler::RemoveTimer( CScheduledFunction* pFunction )
+{
+	if( !pFunction )
+		return;
+
+	auto& engine = *m_OwningModule.GetModule()->GetEngine();
+
+	bool bRemoved = true;
+
+	const auto uiHeapIndex = pFunction->GetHeapIndex();
+
+	if( uiHeapIndex < m_Heap.size() && m_Heap[ uiHeapIndex ] == pFunction )
+	{
+		RemoveFunction( engine, HeapRemove( uiHeapIndex ) );
+	}
+	//If we're currently executing this function, remove it later.
+	else if( m_pCurrentFunction == pFunction )
+	{
+		m_bShouldRemove = true;
+	}
+	else
+	{
+		bRemoved = RemoveFromList( engine, m_ThinkList, pFunction ) || RemoveFromList( engine, m_CalledList, pFunction );
 	}
 
 	if( !bRemoved )
@@ -294,145 +587,418 @@ CASScheduler::CScheduledFunction* CASScheduler::GetCurrentFunction() const
 
 void CASScheduler::Think( const float flCurrentTime )
 {
-	m_bThinking = true;
+	CallDueFunctions( flCurrentTime, nullptr );
+}
 
-	CScheduledFunction* pNext = m_pFunctionListHead;
-	CScheduledFunction* pLast = nullptr;
-	CScheduledFunction* pNextNext = nullptr;
+CASScheduler::ThinkResult_t CASScheduler::ThinkBudgeted( const float flCurrentTime, const unsigned int uiMaxMicroseconds )
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds( uiMaxMicroseconds );
+
+	return CallDueFunctions( flCurrentTime, &deadline );
+}
+
+CASScheduler::ThinkResult_t CASScheduler::CallDueFunctions( const float flCurrentTime, const std::chrono::steady_clock::time_point* pDeadline )
+{
+	m_bThinking = true;
 
-	bool bRemove;
+	ThinkResult_t result;
 
 	auto& engine = *m_OwningModule.GetModule()->GetEngine();
 
 	{
 		CASOwningContext context( engine );
 
-		while( pNext )
+		//Only functions that are due are visited.
+		while( !m_Heap.empty() && m_Heap.front()->GetNextCallTime() <= flCurrentTime )
 		{
-			bRemove = false;
+			//Always call at least one function so overdue functions can't be deferred forever.
+			if( pDeadline && result.uiCalled > 0 && std::chrono::steady_clock::now() >= *pDeadline )
+				break;
 
-			pNextNext = pNext->GetNext();
+			auto pFunction = HeapRemove( 0 );
 
-			m_pCurrentFunction = pNext;
-
-			//Scripts can change the repeat count setting, so make sure to check it
-			if( pNext->ShouldRemove() )
-			{
-				bRemove = true;
-			}
-			else
-			{
-				if( pNext->GetNextCallTime() <= flCurrentTime )
-				{
-					auto* pFunction = pNext->GetFunction();
-
-					//Must happen before the actual call so scripts can "amend" the repeat count if they want to
-					pNext->Called();
-
-					//Set this now so scripts can modify it if they want to
-					pNext->SetNextCallTime( flCurrentTime + pNext->GetRepeatTime() );
-
-					bool bSuccess = false;
-
-					if( auto pThis = pNext->GetThis() )
-					{
-						CASMethod method( *pFunction, context, pThis );
-
-						bSuccess = method.CallArgs( CallFlag::NONE, *pNext->GetArguments() );
-					}
-					else
-					{
-						CASFunction function( *pFunction, context );
-
-						bSuccess = function.CallArgs( CallFlag::NONE, *pNext->GetArguments() );
-					}
-
-					if( !bSuccess )
-					{
-						if( auto pType = pFunction->GetObjectType() )
-						{
-							as::Critical( "Error: CScheduler::Think: execution of method %s::%s::%s failed!\n",
-										  pType->GetNamespace(), pType->GetName(), pFunction->GetName() );
-						}
-						else
-						{
-							as::Critical( "Error: CScheduler::Think: execution of function %s::%s failed!\n", 
-								pFunction->GetNamespace(), pFunction->GetName() );
-						}
-					}
-
-					//Could've been flagged for removal during the call.
-					if( m_bShouldRemove || pNext->ShouldRemove() )
-					{
-						m_bShouldRemove = false;
-						bRemove = true;
-					}
-				}
-			}
+			m_pCurrentFunction = pFunction;
 
-			if( bRemove )
-				RemoveFunction( engine, pLast, pNext );
+			if( CallFunction( context, *pFunction, flCurrentTime ) )
+				RemoveFunction( engine, pFunction );
 			else
-				pLast = pNext;
+				m_CalledList.push_back( pFunction );
 
-			pNext = pNextNext;
+			++result.uiCalled;
 		}
 	}
 
+	//Deferred functions are still in the heap, so the most overdue one is on top.
+	//Count them before the functions that were called are merged back in.
+	if( pDeadline )
+	{
+		result.uiDeferred = CountDueFunctions( flCurrentTime );
+
+		if( result.uiDeferred > 0 )
+			result.flMaxLateness = flCurrentTime - m_Heap.front()->GetNextCallTime();
+	}
+
 	m_flLastTime = flCurrentTime;
 
 	m_pCurrentFunction = nullptr;
 
 	m_bThinking = false;
 
-	//Functions were scheduled while we were thinking, merge into the main list.
-	if( m_pThinkListHead )
+	//Functions that were called, and functions that were scheduled while we were thinking, are merged into the heap.
+	for( auto pFunction : m_CalledList )
 	{
-		//pLast points to the last function in the main list; if any
-		if( pLast )
-			pLast->SetNext( m_pThinkListHead );
-		else
-			m_pFunctionListHead = m_pThinkListHead;
+		HeapPush( pFunction );
+	}
 
-		m_pThinkListHead = nullptr;
+	m_CalledList.clear();
+
+	for( auto pFunction : m_ThinkList )
+	{
+		HeapPush( pFunction );
 	}
+
+	m_ThinkList.clear();
+
+	return result;
+}
+
+size_t CASScheduler::CountDueFunctions( const float flCurrentTime ) const
+{
+	if( m_Heap.empty() )
+		return 0;
+
+	size_t uiCount = 0;
+
+	const size_t uiSize = m_Heap.size();
+
+	//Children are never due before their parent, so only subtrees whose root is due need to be visited.
+	//The heap is walked in preorder using the index alone, so no stack needs to be allocated.
+	size_t uiIndex = 0;
+
+	while( true )
+	{
+		if( m_Heap[ uiIndex ]->GetNextCallTime() <= flCurrentTime )
+		{
+			++uiCount;
+
+			//Descend into the left child.
+			if( uiIndex * 2 + 1 < uiSize )
+			{
+				uiIndex = uiIndex * 2 + 1;
+				continue;
+			}
+		}
+
+		//Right children have even indices. Ascend until a left child with a right sibling is found.
+		while( uiIndex != 0 && ( uiIndex % 2 == 0 || uiIndex + 1 >= uiSize ) )
+		{
+			uiIndex = ( uiIndex - 1 ) / 2;
+		}
+
+		if( uiIndex == 0 )
+			break;
+
+		++uiIndex;
+	}
+
+	return uiCount;
 }
 
 void CASScheduler::ClearTimerList()
 {
-	CScheduledFunction* pNext;
+	auto& engine = *m_OwningModule.GetModule()->GetEngine();
 
+	auto clearList = [ & ]( Functions_t& list )
+	{
+		for( auto pFunction : list )
+		{
+			pFunction->SetHeapIndex( INVALID_HEAP_INDEX );
+			pFunction->Remove( engine );	//Remove all references to other objects. Prevents memory leaks and circular references.
+			pFunction->Release();
+		}
+
+		list.clear();
+	};
+
+	clearList( m_Heap );
+	clearList( m_ThinkList );
+	clearList( m_CalledList );
+
+	//The function that is being executed isn't in any list, so remove it once it returns.
+	if( m_pCurrentFunction )
+		m_bShouldRemove = true;
+}
+
+void CASScheduler::AdjustTime( float flTime )
+{
+	//Every function is moved by the same amount, so the heap order doesn't change.
+	for( auto pFunction : m_Heap )
+	{
+		pFunction->m_flNextCallTime -= flTime;
+	}
+
+	for( auto pFunction : m_ThinkList )
+	{
+		pFunction->m_flNextCallTime -= flTime;
+	}
+}
+
+void CASScheduler::ClearResolvedFunctions()
+{
+	for( const auto& resolved : m_ResolvedFunctions )
+	{
+		if( resolved.first.pType )
+			resolved.first.pType->Release();
+
+		resolved.second->Release();
+	}
+
+	m_ResolvedFunctions.clear();
+}
+
+size_t CASScheduler::ResolvedFunctionKeyHash_t::operator()( const ResolvedFunctionKey_t& key ) const
+{
+	auto uiHash = as::Hash64( &key.pType, sizeof( key.pType ) );
+
+	uiHash = as::Hash64( key.szName.c_str(), uiHash );
+
+	if( !key.ArgTypeIds.empty() )
+		uiHash = as::Hash64( key.ArgTypeIds.data(), key.ArgTypeIds.size() * sizeof( int ), uiHash );
+
+	return static_cast<size_t>( uiHash );
+}
+
+asIScriptFunction* CASScheduler::FindFunction( asIScriptEngine& engine, asITypeInfo* pType, const std::string& szFunctionName, CASArguments& arguments )
+{
+	m_LookupKey.pType = pType;
+	m_LookupKey.szName = szFunctionName;
+	m_LookupKey.ArgTypeIds.clear();
+
+	for( const auto& arg : arguments.GetArgumentList() )
+	{
+		m_LookupKey.ArgTypeIds.push_back( arg.GetTypeId() );
+	}
+
+	auto it = m_ResolvedFunctions.find( m_LookupKey );
+
+	if( it != m_ResolvedFunctions.end() )
+		return it->second;
+
+	asIScriptFunction* pFunction;
+
+	if( pType )
+		pFunction = as::FindFunction( engine, as::CASMethodIterator( *pType ), szFunctionName, arguments );
+	else
+		pFunction = as::FindFunction( engine, as::CASFunctionIterator( *m_OwningModule.GetModule() ), szFunctionName, arguments );
+
+	//Lookups that fail aren't cached, they log an error every time.
+	if( pFunction )
+	{
+		if( pType )
+			pType->AddRef();
+
+		pFunction->AddRef();
+
+		m_ResolvedFunctions.emplace( m_LookupKey, pFunction );
+	}
+
+	return pFunction;
+}
+
+void CASScheduler::OnNextCallTimeChanged( CScheduledFunction& function )
+{
+	const auto uiHeapIndex = function.GetHeapIndex();
+
+	if( uiHeapIndex != INVALID_HEAP_INDEX )
+		HeapUpdate( uiHeapIndex );
+}
+
+void CASScheduler::OnRepeatCountChanged( CScheduledFunction& function )
+{
+	//The function that is being called is removed once it returns.
+	if( !function.ShouldRemove() || m_pCurrentFunction == &function )
+		return;
+
+	//Remove it now so it doesn't keep its object and arguments alive until it's due.
 	auto& engine = *m_OwningModule.GetModule()->GetEngine();
 
-	while( m_pFunctionListHead )
+	const auto uiHeapIndex = function.GetHeapIndex();
+
+	if( uiHeapIndex < m_Heap.size() && m_Heap[ uiHeapIndex ] == &function )
+	{
+		RemoveFunction( engine, HeapRemove( uiHeapIndex ) );
+	}
+	else if( !RemoveFromList( engine, m_ThinkList, &function ) )
+	{
+		RemoveFromList( engine, m_CalledList, &function );
+	}
+}
+
+bool CASScheduler::CallFunction( CASOwningContext& context, CScheduledFunction& function, const float flCurrentTime )
+{
+	//Scripts can change the repeat count setting, so make sure to check it
+	if( function.ShouldRemove() )
+		return true;
+
+	auto* pFunction = function.GetFunction();
+
+	//Must happen before the actual call so scripts can "amend" the repeat count if they want to
+	function.Called();
+
+	//Set this now so scripts can modify it if they want to
+	function.SetNextCallTime( flCurrentTime + function.GetRepeatTime() );
+
+	bool bSuccess = false;
+
+	if( auto pThis = function.GetThis() )
+	{
+		CASMethod method( *pFunction, context, pThis );
+
+		bSuccess = method.CallArgs( CallFlag::NONE, *function.GetArguments() );
+	}
+	else
+	{
+		CASFunction func( *pFunction, context );
+
+		bSuccess = func.CallArgs( CallFlag::NONE, *function.GetArguments() );
+	}
+
+	if( !bSuccess )
 	{
-		pNext = m_pFunctionListHead->GetNext();
-		m_pFunctionListHead->Remove( engine );	//Remove all references to other objects. Prevents memory leaks and circular references.
-		m_pFunctionListHead->Release();
-		m_pFunctionListHead = pNext;
+		if( auto pType = pFunction->GetObjectType() )
+		{
+			as::Critical( "Error: CScheduler::Think: execution of method %s::%s::%s failed!\n",
+						  pType->GetNamespace(), pType->GetName(), pFunction->GetName() );
+		}
+		else
+		{
+			as::Critical( "Error: CScheduler::Think: execution of function %s::%s failed!\n", 
+				pFunction->GetNamespace(), pFunction->GetName() );
+		}
 	}
+
+	//Could've been flagged for removal during the call.
+	if( m_bShouldRemove || function.ShouldRemove() )
+	{
+		m_bShouldRemove = false;
+		return true;
+	}
+
+	return false;
 }
 
-void CASScheduler::AdjustTime( float flTime )
+void CASScheduler::RemoveFunction( asIScriptEngine& engine, CScheduledFunction* pFunction )
+{
+	pFunction->Remove( engine );
+	pFunction->Release();
+}
+
+bool CASScheduler::RemoveFromList( asIScriptEngine& engine, Functions_t& list, CScheduledFunction* pFunction )
+{
+	auto it = std::find( list.begin(), list.end(), pFunction );
+
+	if( it == list.end() )
+		return false;
+
+	list.erase( it );
+
+	RemoveFunction( engine, pFunction );
+
+	return true;
+}
+
+bool CASScheduler::IsDueBefore( const CScheduledFunction& lhs, const CScheduledFunction& rhs )
+{
+	if( lhs.GetNextCallTime() != rhs.GetNextCallTime() )
+		return lhs.GetNextCallTime() < rhs.GetNextCallTime();
+
+	//Functions that are due at the same time are called in the order they were scheduled.
+	return lhs.GetSequence() < rhs.GetSequence();
+}
+
+void CASScheduler::HeapPush( CScheduledFunction* pFunction )
+{
+	m_Heap.push_back( pFunction );
+
+	pFunction->SetHeapIndex( m_Heap.size() - 1 );
+
+	HeapSiftUp( m_Heap.size() - 1 );
+}
+
+CASScheduler::CScheduledFunction* CASScheduler::HeapRemove( const size_t uiIndex )
 {
-	CScheduledFunction* pNext = m_pFunctionListHead;
+	assert( uiIndex < m_Heap.size() );
 
-	while( pNext )
+	auto pFunction = m_Heap[ uiIndex ];
+
+	auto pLast = m_Heap.back();
+
+	m_Heap.pop_back();
+
+	//Move the last function into the gap.
+	if( uiIndex < m_Heap.size() )
 	{
-		pNext->SetNextCallTime( pNext->GetNextCallTime() - flTime );
-		pNext = pNext->GetNext();
+		HeapSet( uiIndex, pLast );
+		HeapUpdate( uiIndex );
 	}
+
+	pFunction->SetHeapIndex( INVALID_HEAP_INDEX );
+
+	return pFunction;
+}
+
+void CASScheduler::HeapUpdate( const size_t uiIndex )
+{
+	if( uiIndex > 0 && IsDueBefore( *m_Heap[ uiIndex ], *m_Heap[ ( uiIndex - 1 ) / 2 ] ) )
+		HeapSiftUp( uiIndex );
+	else
+		HeapSiftDown( uiIndex );
 }
 
-void CASScheduler::RemoveFunction( asIScriptEngine& engine, CScheduledFunction* pLast, CScheduledFunction* pCurrent )
+void CASScheduler::HeapSiftUp( size_t uiIndex )
 {
-	if( pLast )
-		pLast->SetNext( pCurrent->GetNext() );
-	else 
-		m_pFunctionListHead = pCurrent->GetNext();
+	auto pFunction = m_Heap[ uiIndex ];
+
+	while( uiIndex > 0 )
+	{
+		const size_t uiParent = ( uiIndex - 1 ) / 2;
+
+		if( !IsDueBefore( *pFunction, *m_Heap[ uiParent ] ) )
+			break;
+
+		HeapSet( uiIndex, m_Heap[ uiParent ] );
+
+		uiIndex = uiParent;
+	}
+
+	HeapSet( uiIndex, pFunction );
+}
+
+void CASScheduler::HeapSiftDown( size_t uiIndex )
+{
+	auto pFunction = m_Heap[ uiIndex ];
+
+	const size_t uiSize = m_Heap.size();
+
+	while( true )
+	{
+		size_t uiChild = uiIndex * 2 + 1;
 
-	pCurrent->Remove( engine );
-	pCurrent->Release();
+		if( uiChild >= uiSize )
+			break;
+
+		if( uiChild + 1 < uiSize && IsDueBefore( *m_Heap[ uiChild + 1 ], *m_Heap[ uiChild ] ) )
+			++uiChild;
+
+		if( !IsDueBefore( *m_Heap[ uiChild ], *pFunction ) )
+			break;
+
+		HeapSet( uiIndex, m_Heap[ uiChild ] );
+
+		uiIndex = uiChild;
+	}
+
+	HeapSet( uiIndex, pFunction );
 }
 
 static void RegisterScriptScheduledFunction( asIScriptEngine* pEngine )
@@ -531,6 +1097,34 @@ void RegisterScriptScheduler( asIScriptEngine* pEngine )
 		pszObjectName, "CScheduledFunction@ SetInterval(?& in thisObject, const " AS_STRING_OBJNAME "& in szFunction, float flRepeatTime)",
 		asFUNCTION( CASScheduler::SetIntervalObj_NoArgs ), asCALL_GENERIC );
 
+	/*
+	*	Function handle and delegate variants
+	*/
+
+	pEngine->RegisterObjectMethod(
+		pszObjectName, "CScheduledFunction@ SetTimeout(?& in pFunction, float flDelay)",
+		asMETHOD( CASScheduler, SetTimeoutCallback ), asCALL_THISCALL );
+
+	as::RegisterVarArgsMethod(
+		*pEngine, pszObjectName,
+		"CScheduledFunction@", "SetTimeout", "?& in pFunction, float flDelay",
+		1, 8,
+		asFUNCTION( CASScheduler::SetTimeoutCallbackHandler ) );
+
+	pEngine->RegisterObjectMethod(
+		pszObjectName, "CScheduledFunction@ SetInterval(?& in pFunction, float flRepeatTime, int iRepeatCount)",
+		asMETHOD( CASScheduler, SetIntervalCallback ), asCALL_THISCALL );
+
+	as::RegisterVarArgsMethod(
+		*pEngine, pszObjectName,
+		"CScheduledFunction@", "SetInterval", "?& in pFunction, float flRepeatTime, int iRepeatCount",
+		1, 8,
+		asFUNCTION( CASScheduler::SetIntervalCallbackHandler ) );
+
+	pEngine->RegisterObjectMethod(
+		pszObjectName, "CScheduledFunction@ SetInterval(?& in pFunction, float flRepeatTime)",
+		asMETHOD( CASScheduler, SetIntervalCallback_NoArgs ), asCALL_THISCALL );
+
 	pEngine->RegisterObjectMethod(
 		pszObjectName, "void RemoveTimer(CScheduledFunction@ pFunction)", 
 		asMETHOD( CASScheduler, RemoveTimer ), asCALL_THISCALL );
@@ -2,15 +2,20 @@
 #define ANGELSCRIPT_SCRIPTAPI_CASSCHEDULER_H
 
 #include <cassert>
+#include <chrono>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <angelscript.h>
 
 #include "Angelscript/util/CASBaseClass.h"
 
+#include "Angelscript/wrapper/CASArguments.h"
+
 class CASModule;
 class CScriptAny;
-class CASArguments;
+class CASOwningContext;
 
 /**
 *	Schedules functions for execution at a set time.
@@ -21,6 +26,11 @@ public:
 	static const int REPEAT_INF_TIMES = -1;
 	const int REPEAT_INFINITE_TIMES = REPEAT_INF_TIMES; //For scripts
 
+	/**
+	*	Heap index of functions that aren't in the heap.
+	*/
+	static const size_t INVALID_HEAP_INDEX = static_cast<size_t>( -1 );
+
 public:
 
 	/**
@@ -30,51 +40,16 @@ public:
 	{
 	public:
 		/**
-		*	Constructor.
-		*	@param pFunction Function.
-		*	@param flNextCallTime Time when the function should be called.
-		*	@param flRepeatTime Time between calls.
-		*	@param iRepeatCount Number of times to call the function, or infinite if REPEAT_INF_TIMES is given.
-		*	@param pThis This pointer. Can be null.
-		*	@param iTypeId This pointer type id.
-		*	@param pArguments Function arguments.
-		*	@param pNext Next function in the list.
+		*	Constructor. Functions are created by the scheduler's pool, and set up with Init.
+		*	@param pPool Scheduler whose pool the function belongs to.
 		*/
-		CScheduledFunction( asIScriptFunction* const pFunction,
-			const float flNextCallTime, const float flRepeatTime, const int iRepeatCount, 
-			void* const pThis, const int iTypeId, CASArguments* pArguments, CScheduledFunction* const pNext = nullptr )
+		CScheduledFunction( CASScheduler* const pPool )
 			: CASRefCountedBaseClass()
-			, m_pFunction( pFunction )
-			, m_flNextCallTime( flNextCallTime )
-			, m_flRepeatTime( flRepeatTime )
-			, m_iRepeatCount( iRepeatCount )
-			, m_pThis( pThis )
-			, m_iTypeId( iTypeId )
-			, m_pArguments( pArguments )
-			, m_pNext( pNext )
+			, m_pPool( pPool )
 		{
-			pFunction->AddRef();
 		}
 
-		void Release() const
-		{
-			if( InternalRelease() )
-				delete this;
-		}
-
-		/**
-		*	@return The next function in the list.
-		*/
-		CScheduledFunction* GetNext() const { return m_pNext; }
-
-		/**
-		*	Sets the next function in the list.
-		*	@param pNext Next function.
-		*/
-		void SetNext( CScheduledFunction* const pNext ) 
-		{ 
-			m_pNext = pNext;
-		}
+		void Release() const;
 
 		/**
 		*	@return The function to call.
@@ -87,10 +62,10 @@ public:
 		float GetNextCallTime() const { return m_flNextCallTime; }
 
 		/**
-		*	Sets the next call time.
+		*	Sets the next call time. Reschedules the function if it's waiting to be called.
 		*	@param flNextCallTime Next call time.
 		*/
-		void SetNextCallTime( const float flNextCallTime ) { m_flNextCallTime = flNextCallTime; }
+		void SetNextCallTime( const float flNextCallTime );
 
 		/**
 		*	@return The time between calls.
@@ -121,16 +96,10 @@ public:
 
 		/**
 		*	Sets the number of times to call the function, or an infinite number of times if REPEAT_INF_TIMES is given.
+		*	If this is 0, the function is removed immediately, or after the call completes if it is being called.
 		*	@param iRepeatCount Number of times to call the function.
 		*/
-		void SetRepeatCount( const int iRepeatCount )
-		{
-			//Allow 0, will cause immediate removal after call completes, or next call
-			if( iRepeatCount < REPEAT_INF_TIMES )
-				return;
-
-			m_iRepeatCount = iRepeatCount;
-		}
+		void SetRepeatCount( const int iRepeatCount );
 
 		/**
 		*	Makes the function be called an infinite number of times.
@@ -145,7 +114,7 @@ public:
 		*/
 		void Called()
 		{
-			assert( m_iRepeatCount > 0 );
+			assert( IsInfiniteRepeat() || m_iRepeatCount > 0 );
 
 			if( !IsInfiniteRepeat() )
 				--m_iRepeatCount;
@@ -183,34 +152,130 @@ public:
 		/**
 		*	@return The list of arguments.
 		*/
-		CASArguments* GetArguments() const { return m_pArguments; }
+		const CASArguments* GetArguments() const { return &m_Arguments; }
+
+		/**
+		*	@copydoc GetArguments() const
+		*/
+		CASArguments* GetArguments() { return &m_Arguments; }
+
+		/**
+		*	@return The sequence number.
+		*/
+		size_t GetSequence() const { return m_uiSequence; }
+
+		/**
+		*	@return Index of this function in the scheduler's heap, or INVALID_HEAP_INDEX if it isn't in the heap.
+		*/
+		size_t GetHeapIndex() const { return m_uiHeapIndex; }
 
 	private:
+		friend class CASScheduler;
+
+		/**
+		*	Sets up the function to be scheduled. The arguments must have been set already.
+		*	@param pFunction Function.
+		*	@param flNextCallTime Time when the function should be called.
+		*	@param flRepeatTime Time between calls.
+		*	@param iRepeatCount Number of times to call the function, or infinite if REPEAT_INF_TIMES is given.
+		*	@param pThis This pointer. Can be null.
+		*	@param iTypeId This pointer type id.
+		*	@param pScheduler Scheduler that the function is scheduled in.
+		*	@param uiSequence Sequence number. Orders functions that are due at the same time.
+		*/
+		void Init( asIScriptFunction* const pFunction,
+			const float flNextCallTime, const float flRepeatTime, const int iRepeatCount,
+			void* const pThis, const int iTypeId, CASScheduler* const pScheduler, const size_t uiSequence );
+
+		/**
+		*	Sets the index of this function in the scheduler's heap.
+		*	@param uiHeapIndex Heap index.
+		*/
+		void SetHeapIndex( const size_t uiHeapIndex ) { m_uiHeapIndex = uiHeapIndex; }
+
 		/**
 		*	Destructor. Should never be called directly.
 		*/
 		~CScheduledFunction();
 
 	private:
-		asIScriptFunction*	m_pFunction;
-		float				m_flNextCallTime;
-		float				m_flRepeatTime;
-		int					m_iRepeatCount;
+		asIScriptFunction*	m_pFunction = nullptr;
+		float				m_flNextCallTime = 0;
+		float				m_flRepeatTime = 0;
+		int					m_iRepeatCount = 0;
 
-		void*				m_pThis;
-		const int			m_iTypeId;
+		void*				m_pThis = nullptr;
+		int					m_iTypeId = 0;
 
-		CASArguments*		m_pArguments;
+		/**
+		*	Kept when the function is returned to the pool, so its storage is reused.
+		*/
+		CASArguments		m_Arguments;
 
-		CScheduledFunction*	m_pNext;
+		CASScheduler*		m_pScheduler = nullptr;
+		size_t				m_uiSequence = 0;
+		size_t				m_uiHeapIndex = INVALID_HEAP_INDEX;
 
-		bool				m_bRemoved = false;
+		/**
+		*	Scheduler whose pool this function is returned to when it is released. Null if the scheduler was destroyed first.
+		*/
+		CASScheduler*		m_pPool;
+
+		bool				m_bRemoved = true;
+		bool				m_bInPool = false;
 
 	private:
 		CScheduledFunction( const CScheduledFunction& ) = delete;
 		CScheduledFunction& operator=( const CScheduledFunction& ) = delete;
 	};
 
+	/**
+	*	Statistics about the pool of scheduled functions.
+	*/
+	struct PoolStats_t final
+	{
+		/**
+		*	Number of functions that the pool has allocated, in use or not.
+		*/
+		size_t uiPoolSize = 0;
+
+		/**
+		*	Number of functions that are waiting to be reused.
+		*/
+		size_t uiFree = 0;
+
+		/**
+		*	Highest number of functions that were in use at the same time.
+		*/
+		size_t uiHighWaterMark = 0;
+
+		/**
+		*	Number of functions that were reused instead of allocated.
+		*/
+		size_t uiReuseCount = 0;
+	};
+
+	/**
+	*	Result of a call to ThinkBudgeted.
+	*/
+	struct ThinkResult_t final
+	{
+		/**
+		*	Number of functions that were called.
+		*/
+		size_t uiCalled = 0;
+
+		/**
+		*	Number of functions that were due, but were left for the next think because the budget was spent.
+		*/
+		size_t uiDeferred = 0;
+
+		/**
+		*	How far past its call time the most overdue deferred function is. 0 if no functions were deferred.
+		*/
+		float flMaxLateness = 0;
+	};
+
 public:
 	/**
 	*	Constructor.
@@ -240,6 +305,24 @@ public:
 
 	static void SetIntervalObj_NoArgs( asIScriptGeneric* pArguments );
 
+	static void SetTimeoutCallbackHandler( asIScriptGeneric* pArguments );
+
+	static void SetIntervalCallbackHandler( asIScriptGeneric* pArguments );
+
+	/**
+	*	Script overloads that take a function handle or delegate, followed by the arguments to pass to it.
+	*	The parameter can't be a funcdef handle, since functions with any parameters can be scheduled. The value is checked when it is scheduled instead:
+	*	values that aren't functions or delegates, null handles, and arguments that don't match the function's parameters are logged, and null is returned.
+	*	Handles should be passed with @, e.g. SetTimeout( @Func, 1 ) or SetTimeout( @pFunc, 1 ). Without it, a null handle raises a null pointer exception in the caller.
+	*	Delegates keep a reference to their object until the scheduled function is removed.
+	*	Functions without arguments are registered with the native calling convention.
+	*/
+	CScheduledFunction* SetTimeoutCallback( void* pValue, int iTypeId, float flDelay );
+
+	CScheduledFunction* SetIntervalCallback( void* pValue, int iTypeId, float flRepeatTime, int iRepeatCount );
+
+	CScheduledFunction* SetIntervalCallback_NoArgs( void* pValue, int iTypeId, float flRepeatTime );
+
 	/**
 	*	Sets an interval (call function every N seconds).
 	*	@param szFunctionName Name of the function to call.
@@ -262,6 +345,29 @@ public:
 	*/
 	void SetInterval( void* pThis, int iTypeId, const std::string& szFunctionName, float flRepeatTime, int iRepeatCount, asUINT uiStartIndex, asIScriptGeneric& arguments );
 
+	/**
+	*	Schedules a function or delegate to be called once after a delay. No name lookup is performed.
+	*	@param pFunction Function or delegate to call. Must take no parameters and return void.
+	*	@param flDelay Time until the call.
+	*	@return Scheduled function, or null on failure. The caller receives a reference.
+	*/
+	CScheduledFunction* SetTimeout( asIScriptFunction* pFunction, float flDelay )
+	{
+		return SetInterval( pFunction, flDelay, 1 );
+	}
+
+	/**
+	*	Schedules a function or delegate to be called every N seconds. No name lookup is performed.
+	*	@param pFunction Function or delegate to call. Must take no parameters and return void.
+	*	@param flRepeatTime Time between calls.
+	*	@param iRepeatCount Number of times to call the function.
+	*	@return Scheduled function, or null on failure. The caller receives a reference.
+	*/
+	CScheduledFunction* SetInterval( asIScriptFunction* pFunction, float flRepeatTime, int iRepeatCount = REPEAT_INF_TIMES )
+	{
+		return ScheduleCallback( pFunction, flRepeatTime, iRepeatCount, 0, nullptr );
+	}
+
 	/**
 	*	Removes a scheduled function.
 	*	@param pFunction Function to remove.
@@ -279,6 +385,16 @@ public:
 	*/
 	void Think( const float flCurrentTime );
 
+	/**
+	*	Calls functions whose next call time falls between the last think time and flCurrentTime, until the time budget is spent.
+	*	Functions that are still due are left for the next think, which calls them first, most overdue first.
+	*	At least one function is called so every think makes progress.
+	*	@param flCurrentTime Current time.
+	*	@param uiMaxMicroseconds Time budget, in microseconds.
+	*	@return How many functions were called and deferred.
+	*/
+	ThinkResult_t ThinkBudgeted( const float flCurrentTime, const unsigned int uiMaxMicroseconds );
+
 	/**
 	*	Removes all scheduled functions.
 	*/
@@ -290,25 +406,235 @@ public:
 	*/
 	void AdjustTime( float flTime );
 
+	/**
+	*	Releases the functions that were cached by SetInterval. Must be called when the owning module is discarded.
+	*/
+	void ClearResolvedFunctions();
+
+	/**
+	*	@return Statistics about the pool of scheduled functions.
+	*/
+	PoolStats_t GetPoolStats() const;
+
+	/**
+	*	Frees the functions that are waiting in the pool to be reused.
+	*/
+	void TrimPool();
+
+	/**
+	*	@return The number of scheduled functions.
+	*/
+	size_t GetFunctionCount() const { return m_Heap.size() + m_ThinkList.size() + m_CalledList.size(); }
+
 private:
+	typedef std::vector<CScheduledFunction*> Functions_t;
+
+	/**
+	*	Gets a function from the pool, or allocates one if the pool is empty. Its arguments are empty.
+	*/
+	CScheduledFunction* AllocateFunction();
+
+	/**
+	*	Returns a function that was released to the pool.
+	*/
+	void FreeFunction( CScheduledFunction* pFunction );
+
+	/**
+	*	Adds a function to the scheduler.
+	*	@param engine Script engine.
+	*	@param pFunc Function from AllocateFunction, with its arguments set.
+	*	@param pFunction Function to call.
+	*	@param pThis This pointer. Can be null. A reference is added to it.
+	*	@param iTypeId This pointer type id.
+	*	@param flRepeatTime Time between calls.
+	*	@param iRepeatCount Number of times to call the function.
+	*	@return Scheduled function, with a reference for the caller.
+	*/
+	CScheduledFunction* Schedule( asIScriptEngine& engine, CScheduledFunction* pFunc, asIScriptFunction* pFunction, void* pThis, const int iTypeId,
+		const float flRepeatTime, const int iRepeatCount );
+
+	/**
+	*	Schedules a function or delegate. The arguments are checked against the function's parameters directly.
+	*	@param pCallback Function or delegate to call.
+	*	@param flRepeatTime Time between calls.
+	*	@param iRepeatCount Number of times to call the function.
+	*	@param uiStartIndex First argument to get for the function call.
+	*	@param pArguments Optional. Generic call instance to get function call arguments from. If null, the function takes no arguments.
+	*	@return Scheduled function, or null on failure. The caller receives a reference.
+	*/
+	CScheduledFunction* ScheduleCallback( asIScriptFunction* pCallback, float flRepeatTime, int iRepeatCount, asUINT uiStartIndex, asIScriptGeneric* pArguments );
+
+	/**
+	*	Gets the function from a function handle passed by a script.
+	*	@param pValue Pointer to the handle.
+	*	@param iTypeId Type id of the handle.
+	*	@return Function, or null if the value is not a function handle or is null.
+	*/
+	asIScriptFunction* GetCallbackFromValue( void* pValue, int iTypeId ) const;
+
 	/**
-	*	Removes a single function from the list.
+	*	Identifies a function that SetInterval looked up.
+	*/
+	struct ResolvedFunctionKey_t final
+	{
+		/**
+		*	Type whose methods were searched, or null for the module's global functions.
+		*/
+		asITypeInfo* pType = nullptr;
+
+		std::string szName;
+
+		/**
+		*	Type ids of the arguments that the function was matched against.
+		*/
+		std::vector<int> ArgTypeIds;
+
+		bool operator==( const ResolvedFunctionKey_t& other ) const
+		{
+			return pType == other.pType && szName == other.szName && ArgTypeIds == other.ArgTypeIds;
+		}
+	};
+
+	struct ResolvedFunctionKeyHash_t final
+	{
+		size_t operator()( const ResolvedFunctionKey_t& key ) const;
+	};
+
+	typedef std::unordered_map<ResolvedFunctionKey_t, asIScriptFunction*, ResolvedFunctionKeyHash_t> ResolvedFunctions_t;
+
+	/**
+	*	Finds the function to schedule. Functions that were found before are returned from the cache.
 	*	@param engine Script engine.
-	*	@param pLast Last function. Can be null.
-	*	@param pCurrent Function to remove.
+	*	@param pType Type whose methods to search, or null to search the module's global functions.
+	*	@param szFunctionName Name of the function.
+	*	@param arguments Arguments that the function must accept.
+	*	@return Function, or null if no function could be found.
+	*/
+	asIScriptFunction* FindFunction( asIScriptEngine& engine, asITypeInfo* pType, const std::string& szFunctionName, CASArguments& arguments );
+
+	/**
+	*	Called when the next call time of a function changes. Moves the function to its new position if it's in the heap.
 	*/
-	void RemoveFunction( asIScriptEngine& engine, CScheduledFunction* pLast, CScheduledFunction* pCurrent );
+	void OnNextCallTimeChanged( CScheduledFunction& function );
+
+	/**
+	*	Called when the repeat count of a function changes. Removes the function if it won't be called anymore.
+	*/
+	void OnRepeatCountChanged( CScheduledFunction& function );
+
+	/**
+	*	Calls functions that are due.
+	*	@param flCurrentTime Current time.
+	*	@param pDeadline Optional. If given, stops calling functions once this time is reached, and counts the functions that were deferred.
+	*	@return How many functions were called and deferred.
+	*/
+	ThinkResult_t CallDueFunctions( const float flCurrentTime, const std::chrono::steady_clock::time_point* pDeadline );
+
+	/**
+	*	@return The number of functions in the heap that are due.
+	*/
+	size_t CountDueFunctions( const float flCurrentTime ) const;
+
+	/**
+	*	Calls a function that is due.
+	*	@param context Context to use.
+	*	@param function Function to call.
+	*	@param flCurrentTime Current time.
+	*	@return Whether the function should be removed.
+	*/
+	bool CallFunction( CASOwningContext& context, CScheduledFunction& function, const float flCurrentTime );
+
+	/**
+	*	Removes a single function and releases the scheduler's reference to it.
+	*	@param engine Script engine.
+	*	@param pFunction Function to remove.
+	*/
+	void RemoveFunction( asIScriptEngine& engine, CScheduledFunction* pFunction );
+
+	/**
+	*	Removes a function from the given list, if it is in it.
+	*	@return Whether the function was removed.
+	*/
+	bool RemoveFromList( asIScriptEngine& engine, Functions_t& list, CScheduledFunction* pFunction );
+
+	/**
+	*	@return Whether lhs is due before rhs.
+	*/
+	static bool IsDueBefore( const CScheduledFunction& lhs, const CScheduledFunction& rhs );
+
+	/**
+	*	Adds a function to the heap.
+	*/
+	void HeapPush( CScheduledFunction* pFunction );
+
+	/**
+	*	Removes the function at the given index from the heap.
+	*	@return The removed function.
+	*/
+	CScheduledFunction* HeapRemove( const size_t uiIndex );
+
+	/**
+	*	Moves the function at the given index up or down to restore the heap order.
+	*/
+	void HeapUpdate( const size_t uiIndex );
+
+	void HeapSiftUp( size_t uiIndex );
+
+	void HeapSiftDown( size_t uiIndex );
+
+	void HeapSet( const size_t uiIndex, CScheduledFunction* pFunction )
+	{
+		m_Heap[ uiIndex ] = pFunction;
+		pFunction->SetHeapIndex( uiIndex );
+	}
 
 private:
 	CASModule& m_OwningModule;
 	float m_flLastTime = 0.0f;
 
-	CScheduledFunction* m_pFunctionListHead = nullptr;
+	/*
+	*	Functions that are waiting to be called, as a min-heap ordered by next call time. Think only visits the functions that are due.
+	*/
+	Functions_t m_Heap;
+
+	/*
+	*	Used to store functions scheduled in another scheduled function that was being executed. Is merged with the heap at the end of Think.
+	*/
+	Functions_t m_ThinkList;
+
+	/*
+	*	Functions that were called during Think and will be called again. Is merged with the heap at the end of Think, so functions are called at most once per Think.
+	*/
+	Functions_t m_CalledList;
+
+	/*
+	*	Functions that SetInterval has found, so scheduling the same function again doesn't search the module.
+	*	Holds references to the functions and types.
+	*/
+	ResolvedFunctions_t m_ResolvedFunctions;
+
+	/*
+	*	Reused to build lookup keys without allocating.
+	*/
+	ResolvedFunctionKey_t m_LookupKey;
+
+	/*
+	*	Every function that the pool has allocated and not freed, in use or not.
+	*/
+	Functions_t m_PooledFunctions;
+
+	/*
+	*	Functions that are waiting to be reused.
+	*/
+	Functions_t m_FreeFunctions;
+
+	size_t m_uiPoolHighWaterMark = 0;
+	size_t m_uiPoolReuseCount = 0;
 
 	/*
-	*	Used to store functions scheduled in another scheduled function that was being executed. Is merged with the main list at the end of Think.
+	*	Sequence number to give to the next scheduled function.
 	*/
-	CScheduledFunction* m_pThinkListHead = nullptr;
+	size_t m_uiNextSequence = 0;
 
 	/*
 	*	The current function being executed, if any.
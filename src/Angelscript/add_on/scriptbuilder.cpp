@@ -1,4 +1,5 @@
 #include "scriptbuilder.h"
+#include "Angelscript/util/CASMappedFile.h"
 #include <vector>
 #include <assert.h>
 using namespace std;
@@ -17,6 +18,11 @@ using namespace std;
 
 BEGIN_AS_NAMESPACE
 
+struct CScriptBuilder::SMappedFiles
+{
+	vector<CASMappedFile> files;
+};
+
 // Helper functions
 static string GetCurrentDir();
 static string GetAbsolutePath(const string &path);
@@ -29,6 +35,21 @@ CScriptBuilder::CScriptBuilder()
 
 	includeCallback = 0;
 	callbackParam   = 0;
+
+	sectionCallback      = 0;
+	sectionCallbackParam = 0;
+
+	sectionCache = 0;
+
+	useMappedFiles  = false;
+	allowZeroCopy   = false;
+	zeroCopyBlocked = false;
+	mappedFiles     = 0;
+}
+
+CScriptBuilder::~CScriptBuilder()
+{
+	delete mappedFiles;
 }
 
 void CScriptBuilder::SetIncludeCallback(INCLUDECALLBACK_t callback, void *userParam)
@@ -37,6 +58,28 @@ void CScriptBuilder::SetIncludeCallback(INCLUDECALLBACK_t callback, void *userPa
 	callbackParam   = userParam;
 }
 
+void CScriptBuilder::SetSectionCallback(SECTIONCALLBACK_t callback, void *userParam)
+{
+	sectionCallback      = callback;
+	sectionCallbackParam = userParam;
+}
+
+void CScriptBuilder::SetSectionCache(CScriptSectionCache *cache)
+{
+	sectionCache = cache;
+}
+
+void CScriptBuilder::SetUseMappedFiles(bool enable, bool zeroCopy)
+{
+	useMappedFiles = enable;
+	allowZeroCopy  = enable && zeroCopy;
+}
+
+void CScriptBuilder::SetZeroCopyBlocked(bool blocked)
+{
+	zeroCopyBlocked = blocked;
+}
+
 int CScriptBuilder::StartNewModule(asIScriptEngine *inEngine, const char *moduleName)
 {
 	if(inEngine == 0 ) return -1;
@@ -74,6 +117,11 @@ string CScriptBuilder::GetSectionName(unsigned int idx) const
 	return *it;
 }
 
+bool CScriptBuilder::IsSectionFromFile(const char *sectionName) const
+{
+	return fileSections.find(sectionName) != fileSections.end();
+}
+
 // Returns 1 if the section was included
 // Returns 0 if the section was not included because it had already been included before
 // Returns <0 if there was an error
@@ -85,6 +133,8 @@ int CScriptBuilder::AddSectionFromFile(const char *filename)
 
 	if( IncludeIfNotAlreadyIncluded(fullpath.c_str()) )
 	{
+		fileSections.insert(fullpath);
+
 		int r = LoadScriptSection(fullpath.c_str());
 		if( r < 0 )
 			return r;
@@ -117,6 +167,44 @@ int CScriptBuilder::BuildModule()
 	return Build();
 }
 
+int CScriptBuilder::BuildModuleFromByteCode(asIBinaryStream *in, bool *wasDebugInfoStripped)
+{
+	if( includedScripts.empty() )
+	{
+		int r = module->LoadByteCode(in, wasDebugInfoStripped);
+		if( r < 0 )
+			return r;
+
+		return ProcessMetadata();
+	}
+
+	// The engine only frees the added script sections when the module is built or
+	// destroyed, so load the bytecode into a new module that replaces this one. The
+	// sections are kept until the load succeeds so the caller can still build them.
+	string name = module->GetName();
+	asIScriptModule *loaded = engine->GetModule((name + " <bytecode>").c_str(), asGM_ALWAYS_CREATE);
+	if( loaded == 0 )
+		return -1;
+
+	asDWORD accessMask = module->SetAccessMask(0);
+	module->SetAccessMask(accessMask);
+	loaded->SetAccessMask(accessMask);
+	loaded->SetDefaultNamespace(module->GetDefaultNamespace());
+
+	int r = loaded->LoadByteCode(in, wasDebugInfoStripped);
+	if( r < 0 )
+	{
+		loaded->Discard();
+		return r;
+	}
+
+	module->Discard();
+	loaded->SetName(name.c_str());
+	module = loaded;
+
+	return ProcessMetadata();
+}
+
 void CScriptBuilder::DefineWord(const char *word)
 {
 	string sword = word;
@@ -126,9 +214,17 @@ void CScriptBuilder::DefineWord(const char *word)
 	}
 }
 
+const set<string> &CScriptBuilder::GetDefinedWords() const
+{
+	return definedWords;
+}
+
 void CScriptBuilder::ClearAll()
 {
 	includedScripts.clear();
+	fileSections.clear();
+	if( mappedFiles )
+		mappedFiles->files.clear();
 
 #if AS_PROCESS_METADATA == 1
 	currentClass = "";
@@ -156,62 +252,221 @@ bool CScriptBuilder::IncludeIfNotAlreadyIncluded(const char *filename)
 	return true;
 }
 
+// Finds the ranges of the code that were changed by the pre-processing
+static void FindEdits(const string &code, const string &processedCode, vector<CScriptSectionCache::SEdit> &edits)
+{
+	// Overwritten code keeps its line breaks, so edits that are only a few characters
+	// apart are merged instead of making an edit for every line
+	const size_t maxGap = 16;
+
+	size_t pos = 0;
+	while( pos < code.length() )
+	{
+		if( code[pos] == processedCode[pos] )
+		{
+			pos++;
+			continue;
+		}
+
+		size_t end = pos + 1;
+		for( size_t next = end; next < code.length() && next - end <= maxGap; next++ )
+		{
+			if( code[next] != processedCode[next] )
+				end = next + 1;
+		}
+
+		CScriptSectionCache::SEdit edit;
+		edit.offset = (unsigned int)pos;
+		edit.text.assign(processedCode, pos, end - pos);
+		edits.push_back(edit);
+
+		pos = end;
+	}
+}
+
 int CScriptBuilder::LoadScriptSection(const char *filename)
 {
-	// Open the script file
-	string scriptFile = filename;
-#if _MSC_VER >= 1500 && !defined(__S3E__)
-	FILE *f = 0;
-	fopen_s(&f, scriptFile.c_str(), "rb");
+	// The pre-processed code only depends on the file and the defined words if
+	// the section doesn't start inside a class or namespace declaration
+#if AS_PROCESS_METADATA == 1
+	bool cacheable = sectionCache && currentClass == "" && currentNamespace == "";
 #else
-	FILE *f = fopen(scriptFile.c_str(), "rb");
+	bool cacheable = sectionCache != 0;
 #endif
-	if( f == 0 )
+
+	// The version is determined before the file is loaded, so a change made while it is loaded is detected the next time
+	CScriptSectionCache::SFileVersion version;
+
+	if( cacheable )
 	{
-		// Write a message to the engine's message callback
-		string msg = "Failed to open script file '" + GetAbsolutePath(scriptFile) + "'";
-		engine->WriteMessage(filename, 0, 0, asMSGTYPE_ERROR, msg.c_str());
+		shared_ptr<const CScriptSectionCache::SEntry> entry = sectionCache->Find(filename, definedWords, version);
+		if( entry )
+		{
+			if( sectionCallback )
+				sectionCallback(filename, entry->code.c_str(), (unsigned int)(entry->code.length()), this, sectionCallbackParam);
 
-		// TODO: Write the file where this one was included from
+			modifiedScript = entry->code;
+			for( size_t n = 0; n < entry->edits.size(); n++ )
+				modifiedScript.replace(entry->edits[n].offset, entry->edits[n].text.length(), entry->edits[n].text);
+#if AS_PROCESS_METADATA == 1
+			foundDeclarations.insert(foundDeclarations.end(), entry->declarations.begin(), entry->declarations.end());
+#endif
+			vector<string> includes = entry->includes;
+			return AddPreprocessedSection(filename, 0, includes);
+		}
+	}
 
-		return -1;
+	// Map the file if requested, so that it doesn't have to be read into memory
+	// before it is pre-processed. Empty files can't be mapped, so they are read
+	CASMappedFile mappedFile;
+	if( useMappedFiles )
+		mappedFile.Open(filename);
+
+	string loadedCode;
+	const char *code;
+	unsigned int length;
+
+	if( mappedFile.IsOpen() )
+	{
+		code   = (const char*)mappedFile.GetData();
+		length = (unsigned int)mappedFile.GetSize();
 	}
+	else
+	{
+		// Open the script file
+		string scriptFile = filename;
+#if _MSC_VER >= 1500 && !defined(__S3E__)
+		FILE *f = 0;
+		fopen_s(&f, scriptFile.c_str(), "rb");
+#else
+		FILE *f = fopen(scriptFile.c_str(), "rb");
+#endif
+		if( f == 0 )
+		{
+			// Write a message to the engine's message callback
+			string msg = "Failed to open script file '" + GetAbsolutePath(scriptFile) + "'";
+			engine->WriteMessage(filename, 0, 0, asMSGTYPE_ERROR, msg.c_str());
+
+			// TODO: Write the file where this one was included from
+
+			return -1;
+		}
+
+		// Determine size of the file
+		fseek(f, 0, SEEK_END);
+		int len = ftell(f);
+		fseek(f, 0, SEEK_SET);
+
+		// On Win32 it is possible to do the following instead
+		// int len = _filelength(_fileno(f));
+
+		// Read the entire file
+		size_t c = 0;
+		if( len > 0 )
+		{
+			loadedCode.resize(len);
+			c = fread(&loadedCode[0], len, 1, f);
+		}
+
+		fclose(f);
 
-	// Determine size of the file
-	fseek(f, 0, SEEK_END);
-	int len = ftell(f);
-	fseek(f, 0, SEEK_SET);
+		if( c == 0 && len > 0 )
+		{
+			// Write a message to the engine's message callback
+			string msg = "Failed to load script file '" + GetAbsolutePath(scriptFile) + "'";
+			engine->WriteMessage(filename, 0, 0, asMSGTYPE_ERROR, msg.c_str());
+			return -1;
+		}
 
-	// On Win32 it is possible to do the following instead
-	// int len = _filelength(_fileno(f));
+		code   = loadedCode.c_str();
+		length = (unsigned int)(loadedCode.length());
+	}
 
-	// Read the entire file
-	string code;
-	size_t c = 0;
-	if( len > 0 )
+	if( !cacheable )
 	{
-		code.resize(len);
-		c = fread(&code[0], len, 1, f);
+		// Sections without directives or metadata are left unchanged by the pre-processing,
+		// so the engine can use the mapped file directly instead of a copy
+		if( mappedFile.IsOpen() && allowZeroCopy && !zeroCopyBlocked && !NeedsPreprocessing(code, length) )
+		{
+			if( sectionCallback )
+				sectionCallback(filename, code, length, this, sectionCallbackParam);
+
+			engine->SetEngineProperty(asEP_COPY_SCRIPT_SECTIONS, false);
+			int r = module->AddScriptSection(filename, code, length, 0);
+			engine->SetEngineProperty(asEP_COPY_SCRIPT_SECTIONS, true);
+
+			// The engine references the mapped file until the module is built
+			if( !mappedFiles )
+				mappedFiles = new SMappedFiles();
+			mappedFiles->files.push_back(std::move(mappedFile));
+
+			return r < 0 ? r : 0;
+		}
+
+		// Process the script section even if it is zero length so that the name is registered
+		return ProcessScriptSection(code, length, filename, 0);
 	}
 
-	fclose(f);
+	if( sectionCallback )
+		sectionCallback(filename, code, length, this, sectionCallbackParam);
+
+	shared_ptr<CScriptSectionCache::SEntry> entry(new CScriptSectionCache::SEntry());
+
+#if AS_PROCESS_METADATA == 1
+	size_t firstDeclaration = foundDeclarations.size();
+#endif
+
+	PreprocessScriptSection(code, length, entry->includes);
 
-	if( c == 0 && len > 0 )
+	// Sections that leave a class or namespace open affect the sections that follow, so they can't be reused.
+	// The pre-processing never changes the length of the code, but if it did the edits couldn't describe it
+#if AS_PROCESS_METADATA == 1
+	if( version.valid && currentClass == "" && currentNamespace == "" && modifiedScript.length() == length )
+#else
+	if( version.valid && modifiedScript.length() == length )
+#endif
 	{
-		// Write a message to the engine's message callback
-		string msg = "Failed to load script file '" + GetAbsolutePath(scriptFile) + "'";
-		engine->WriteMessage(filename, 0, 0, asMSGTYPE_ERROR, msg.c_str());
-		return -1;
+		entry->code.assign(code, length);
+		FindEdits(entry->code, modifiedScript, entry->edits);
+#if AS_PROCESS_METADATA == 1
+		entry->declarations.assign(foundDeclarations.begin() + firstDeclaration, foundDeclarations.end());
+#endif
+		sectionCache->Store(filename, definedWords, version, entry);
 	}
 
-	// Process the script section even if it is zero length so that the name is registered
-	return ProcessScriptSection(code.c_str(), (unsigned int)(code.length()), filename, 0);
+	vector<string> includes = entry->includes;
+	return AddPreprocessedSection(filename, 0, includes);
+}
+
+bool CScriptBuilder::NeedsPreprocessing(const char *script, unsigned int length)
+{
+	// Directives start with #. Metadata starts with [, which is also used for indexing,
+	// so this gives false positives, but never false negatives
+	if( memchr(script, '#', length) )
+		return true;
+
+#if AS_PROCESS_METADATA == 1
+	if( memchr(script, '[', length) )
+		return true;
+#endif
+
+	return false;
 }
 
 int CScriptBuilder::ProcessScriptSection(const char *script, unsigned int length, const char *sectionname, int lineOffset)
 {
 	vector<string> includes;
 
+	if( sectionCallback )
+		sectionCallback(sectionname, script, length ? length : (unsigned int)strlen(script), this, sectionCallbackParam);
+
+	PreprocessScriptSection(script, length, includes);
+
+	return AddPreprocessedSection(sectionname, lineOffset, includes);
+}
+
+void CScriptBuilder::PreprocessScriptSection(const char *script, unsigned int length, vector<string> &includes)
+{
 	// Perform a superficial parsing of the script first to store the metadata
 	if( length )
 		modifiedScript.assign(script, length);
@@ -458,7 +713,10 @@ int CScriptBuilder::ProcessScriptSection(const char *script, unsigned int length
 			pos = SkipStatement(pos);
 		}
 	}
+}
 
+int CScriptBuilder::AddPreprocessedSection(const char *sectionname, int lineOffset, vector<string> &includes)
+{
 	// Build the actual script
 	engine->SetEngineProperty(asEP_COPY_SCRIPT_SECTIONS, true);
 	module->AddScriptSection(sectionname, modifiedScript.c_str(), modifiedScript.size(), lineOffset);
@@ -514,6 +772,11 @@ int CScriptBuilder::Build()
 	if( r < 0 )
 		return r;
 
+	return ProcessMetadata();
+}
+
+int CScriptBuilder::ProcessMetadata()
+{
 #if AS_PROCESS_METADATA == 1
 	// After the script has been built, the metadata strings should be
 	// stored for later lookup by function id, type id, and variable index
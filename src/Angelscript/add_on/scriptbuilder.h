@@ -33,6 +33,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <string.h> // _strcmpi
@@ -40,6 +41,7 @@
 BEGIN_AS_NAMESPACE
 
 class CScriptBuilder;
+class CScriptSectionCache;
 
 // This callback will be called for each #include directive encountered by the
 // builder. The callback should call the AddSectionFromFile or AddSectionFromMemory
@@ -47,12 +49,18 @@ class CScriptBuilder;
 // then the function should return a negative value to abort the compilation.
 typedef int (*INCLUDECALLBACK_t)(const char *include, const char *from, CScriptBuilder *builder, void *userParam);
 
+// This callback will be called for each script section before it is pre-processed,
+// with the code exactly as it was loaded from the file or passed in from memory.
+// It can be used to keep track of the sources that went into a module.
+typedef void (*SECTIONCALLBACK_t)(const char *sectionName, const char *code, unsigned int length, CScriptBuilder *builder, void *userParam);
+
 // Helper class for loading and pre-processing script files to
 // support include directives and metadata declarations
 class CScriptBuilder
 {
 public:
 	CScriptBuilder();
+	~CScriptBuilder();
 
 	// Start a new module
 	int StartNewModule(asIScriptEngine *engine, const char *moduleName);
@@ -75,20 +83,62 @@ public:
 	// Build the added script sections
 	int BuildModule();
 
+	// Load previously saved bytecode into the module instead of building the added
+	// script sections. The sections must still have been added so that the metadata
+	// can be resolved. If sections were added, the module is replaced by a new one
+	// with the same name so that the unused sections are freed.
+	int BuildModuleFromByteCode(asIBinaryStream *in, bool *wasDebugInfoStripped = 0);
+
 	// Returns the current module
 	asIScriptModule *GetModule();
 
 	// Register the callback for resolving include directive
 	void SetIncludeCallback(INCLUDECALLBACK_t callback, void *userParam);
 
+	// Register the callback that is notified of each script section
+	void SetSectionCallback(SECTIONCALLBACK_t callback, void *userParam);
+
+	// Set the cache used to avoid loading and pre-processing the same file more than once.
+	// The cache is not owned by the builder
+	void SetSectionCache(CScriptSectionCache *cache);
+
+	// Map files into memory instead of reading them, so that only the pre-processed
+	// code is held in memory. If zeroCopy is true, files that need no pre-processing
+	// are passed to the engine straight from the mapping, which is kept until the next
+	// module is started. This temporarily turns off asEP_COPY_SCRIPT_SECTIONS, which is
+	// a property of the whole engine, so zero copy must not be used while other builders
+	// add sections to the same engine on other threads. See SetZeroCopyBlocked
+	void SetUseMappedFiles(bool enable, bool zeroCopy = false);
+
+	// Prevents zero copy from being used even if it was requested. Applications that
+	// build modules on several threads block it while those builds can overlap
+	void SetZeroCopyBlocked(bool blocked);
+
 	// Add a pre-processor define for conditional compilation
 	void DefineWord(const char *word);
 
+	// Get the pre-processor defines
+	const std::set<std::string> &GetDefinedWords() const;
+
 	// Enumerate included script sections
 	unsigned int GetSectionCount() const;
 	std::string  GetSectionName(unsigned int idx) const;
 
+	// Returns true if the section was loaded from a file on disk
+	bool IsSectionFromFile(const char *sectionName) const;
+
 #if AS_PROCESS_METADATA == 1
+	// Metadata and the declaration it belongs to, found while pre-processing a section
+	struct SMetadataDecl
+	{
+		SMetadataDecl(std::string m, std::string d, int t, std::string c, std::string ns) : metadata(m), declaration(d), type(t), parentClass(c), nameSpace(ns) {}
+		std::string metadata;
+		std::string declaration;
+		int         type;
+		std::string parentClass;
+		std::string nameSpace;
+	};
+
 	// Get metadata declared for class types and interfaces
 	const char *GetMetadataStringForType(int typeId);
 
@@ -108,8 +158,12 @@ public:
 protected:
 	void ClearAll();
 	int  Build();
+	int  ProcessMetadata();
 	int  ProcessScriptSection(const char *script, unsigned int length, const char *sectionname, int lineOffset);
+	void PreprocessScriptSection(const char *script, unsigned int length, std::vector<std::string> &includes);
+	int  AddPreprocessedSection(const char *sectionname, int lineOffset, std::vector<std::string> &includes);
 	int  LoadScriptSection(const char *filename);
+	static bool NeedsPreprocessing(const char *script, unsigned int length);
 	bool IncludeIfNotAlreadyIncluded(const char *filename);
 
 	int  SkipStatement(int pos);
@@ -124,20 +178,24 @@ protected:
 	INCLUDECALLBACK_t  includeCallback;
 	void              *callbackParam;
 
+	SECTIONCALLBACK_t  sectionCallback;
+	void              *sectionCallbackParam;
+
+	CScriptSectionCache *sectionCache;
+
+	// The mappings passed to the engine by zero copy. Kept out of the header so the add-on doesn't depend on the mapping code
+	struct SMappedFiles;
+
+	bool          useMappedFiles;
+	bool          allowZeroCopy;
+	bool          zeroCopyBlocked;
+	SMappedFiles *mappedFiles;
+
 #if AS_PROCESS_METADATA == 1
 	int  ExtractMetadataString(int pos, std::string &outMetadata);
 	int  ExtractDeclaration(int pos, std::string &outDeclaration, int &outType);
 
-	// Temporary structure for storing metadata and declaration
-	struct SMetadataDecl
-	{
-		SMetadataDecl(std::string m, std::string d, int t, std::string c, std::string ns) : metadata(m), declaration(d), type(t), parentClass(c), nameSpace(ns) {}
-		std::string metadata;
-		std::string declaration;
-		int         type;
-		std::string parentClass;
-		std::string nameSpace;
-	};
+	// Temporary storage for metadata and declarations
 	std::vector<SMetadataDecl> foundDeclarations;
 	std::string currentClass;
 	std::string currentNamespace;
@@ -159,6 +217,10 @@ protected:
 
 #endif
 
+	// The builder owns the mappings, so it can't be copied
+	CScriptBuilder(const CScriptBuilder &);
+	CScriptBuilder &operator=(const CScriptBuilder &);
+
 #ifdef _WIN32
 	// On Windows the filenames are case insensitive so the comparisons to
 	// avoid duplicate includes must also be case insensitive. True case insensitive
@@ -180,13 +242,73 @@ protected:
 		}
 	};
 	std::set<std::string, ci_less> includedScripts;
+	std::set<std::string, ci_less> fileSections;
 #else
 	std::set<std::string>      includedScripts;
+	std::set<std::string>      fileSections;
 #endif
 
 	std::set<std::string>      definedWords;
 };
 
+// Interface for caches that keep the result of pre-processing script files, so
+// that files shared by several modules only have to be loaded and processed once.
+// Only files that are processed outside of class and namespace declarations are
+// cached. Implementations must be thread safe if builders are used on several threads.
+class CScriptSectionCache
+{
+public:
+	// A range of the code that was overwritten by the pre-processing
+	struct SEdit
+	{
+		unsigned int offset;
+		std::string  text;
+	};
+
+	// The result of pre-processing a file. The pre-processing only overwrites directives,
+	// metadata and excluded code, so instead of a second copy of the file only the edits
+	// that turn the loaded code into the pre-processed code are kept
+	struct SEntry
+	{
+		// The code as it was loaded from the file
+		std::string code;
+
+		// The edits made to the code by the pre-processing
+		std::vector<SEdit> edits;
+
+		// The files included by the section, in the order they were found
+		std::vector<std::string> includes;
+
+#if AS_PROCESS_METADATA == 1
+		// The metadata declared in the section
+		std::vector<CScriptBuilder::SMetadataDecl> declarations;
+#endif
+	};
+
+	// Identifies the version of a file that an entry is made from. Find returns it before
+	// the builder loads the file, and the builder passes it back to Store, so that a file
+	// that changes while it is loaded isn't stored as the newer version
+	struct SFileVersion
+	{
+		SFileVersion() : modificationTime(0), size(0), valid(false) {}
+
+		long long          modificationTime;
+		unsigned long long size;
+
+		// If false, the version is unknown and the entry must not be stored
+		bool               valid;
+	};
+
+	virtual ~CScriptSectionCache() {}
+
+	// Returns the cached entry for the file if it is up to date, or null.
+	// The current version of the file is returned in outVersion
+	virtual std::shared_ptr<const SEntry> Find(const char *filename, const std::set<std::string> &definedWords, SFileVersion &outVersion) = 0;
+
+	// Stores the entry made from the given version of the file, replacing any previous entry for the same defined words
+	virtual void Store(const char *filename, const std::set<std::string> &definedWords, const SFileVersion &version, const std::shared_ptr<const SEntry> &entry) = 0;
+};
+
 END_AS_NAMESPACE
 
 #endif
@@ -1,11 +1,94 @@
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <tuple>
 
 #include "Angelscript/util/ASLogging.h"
 
 #include "Angelscript/CASModule.h"
 
 #include "CASBaseEvent.h"
+#include "IASEventHookListener.h"
+
+namespace
+{
+/*
+*	Orders modules using ModuleLess. Functions that don't belong to a module are placed first.
+*/
+bool HookModuleLess( const CASModule* pLHS, const CASModule* pRHS )
+{
+	if( !pLHS || !pRHS )
+		return !pLHS && pRHS;
+
+	return ModuleLess( pLHS, pRHS );
+}
+
+/*
+*	Deleter for dispatch tables. Releases the references held by the table.
+*/
+void ReleaseDispatchEntries( const CASBaseEvent::DispatchEntries_t& entries )
+{
+	for( const auto& entry : entries )
+	{
+		if( entry.pFunction )
+			entry.pFunction->Release();
+	}
+}
+
+/*
+*	Gets the name to show for a hook or listener in profiles.
+*/
+std::string GetHookProfileName( const CASBaseEvent::DispatchEntry& entry )
+{
+	char szBuffer[ 512 ];
+
+	if( entry.pListener )
+	{
+		snprintf( szBuffer, sizeof( szBuffer ), "Native listener %p", static_cast<void*>( entry.pListener ) );
+		return szBuffer;
+	}
+
+	auto pFunction = entry.pFunction;
+
+	if( auto pDelegate = pFunction->GetDelegateFunction() )
+		pFunction = pDelegate;
+
+	auto pModule = pFunction->GetModule();
+
+	snprintf( szBuffer, sizeof( szBuffer ), "Module \"%s\", \"%s\"", pModule ? pModule->GetName() : "", pFunction->GetDeclaration( true, true ) );
+
+	return szBuffer;
+}
+
+void DeleteDispatchTable( const CASBaseEvent::DispatchTable_t* pTable )
+{
+	ReleaseDispatchEntries( pTable->Entries );
+
+	for( const auto& filtered : pTable->FilteredEntries )
+	{
+		ReleaseDispatchEntries( filtered.second );
+	}
+
+	delete pTable;
+}
+
+bool MatchesParams( const asIScriptFunction& function, const ctx::ParamList_t& params )
+{
+	if( function.GetParamCount() != params.size() )
+		return false;
+
+	for( asUINT uiIndex = 0; uiIndex < params.size(); ++uiIndex )
+	{
+		int iTypeId;
+		asDWORD uiFlags;
+
+		if( function.GetParam( uiIndex, &iTypeId, &uiFlags ) < 0 || iTypeId != params[ uiIndex ].iTypeId || uiFlags != params[ uiIndex ].uiFlags )
+			return false;
+	}
+
+	return true;
+}
+}
 
 CASBaseEvent::CASBaseEvent( const asDWORD accessMask )
 	: m_AccessMask( accessMask )
@@ -18,50 +101,93 @@ CASBaseEvent::~CASBaseEvent()
 	RemoveAllFunctions();
 }
 
+void CASBaseEvent::SetFuncDef( asIScriptFunction* pFuncDef )
+{
+	m_pFuncDef = pFuncDef;
+
+	m_Params.clear();
+
+	if( pFuncDef )
+		ctx::GetParamInfo( *pFuncDef, m_Params );
+
+	//Hooks are matched against the parameters when the table is made.
+	m_DispatchTable.reset();
+
+	OnFuncDefChanged();
+}
+
 size_t CASBaseEvent::GetFunctionCount() const
 {
-	return m_Functions.size();
+	return m_Hooks.size();
 }
 
 asIScriptFunction* CASBaseEvent::GetFunctionByIndex( const size_t uiIndex ) const
 {
-	assert( uiIndex < m_Functions.size() );
+	assert( uiIndex < m_Hooks.size() );
 
-	return m_Functions[ uiIndex ];
+	return m_Hooks[ uiIndex ].pFunction;
 }
 
 bool CASBaseEvent::AddFunction( asIScriptFunction* pFunction )
 {
-	assert( pFunction );
+	return AddHook( pFunction, false, 0, nullptr, nullptr );
+}
 
-	//Don't add functions while this event is being invoked.
-	if( IsTriggering() )
-	{
-		as::CASCallerInfo info;
+bool CASBaseEvent::AddFunction( asIScriptFunction* pFunction, const FilterKey_t filterKey )
+{
+	return AddHook( pFunction, true, filterKey, nullptr, nullptr );
+}
 
-		as::GetCallerInfo( info );
+bool CASBaseEvent::AddHook( asIScriptFunction* pFunction, const bool bFiltered, const FilterKey_t filterKey, void* pFilterObject, asITypeInfo* pFilterType )
+{
+	assert( pFunction );
 
-		as::Critical( "CBaseEvent::AddFunction: %s(%d, %d): Cannot add function while invoking event!\n", info.pszSection, info.iLine, info.iColumn );
+	if( !pFunction )
 		return false;
-	}
 
-	if( !pFunction )
+	if( !CanHookFunction( pFunction->GetDelegateFunction() ? *pFunction->GetDelegateFunction() : *pFunction ) )
 		return false;
 
-	if( std::find( m_Functions.begin(), m_Functions.end(), pFunction ) != m_Functions.end() )
+	auto hooked = m_HookedFunctions.equal_range( pFunction );
+
+	//Filtered hooks get an entry for each key.
+	if( std::find_if( hooked.first, hooked.second, [ & ]( const HookedFunctions_t::value_type& hook )
+		{
+			return hook.second.first == bFiltered && ( !bFiltered || hook.second.second == filterKey );
+		} ) != hooked.second )
 		return true;
 
-	m_Functions.push_back( pFunction );
+	m_HookedFunctions.emplace( pFunction, std::make_pair( bFiltered, filterKey ) );
 
-	pFunction->AddRef();
+	const Hook_t hook{ pFunction, GetModuleFromScriptFunction( pFunction ), bFiltered, filterKey, pFilterObject, pFilterType };
 
-	std::stable_sort( m_Functions.begin(), m_Functions.end(), []( const asIScriptFunction* pLHS, const asIScriptFunction* pRHS )
+	if( m_bDeferSort )
 	{
-		auto pLHSModule = GetModuleFromScriptFunction( pLHS );
-		auto pRHSModule = GetModuleFromScriptFunction( pRHS );
+		m_Hooks.push_back( hook );
 
-		return ModuleLess( pLHSModule, pRHSModule );
-	} );
+		m_bNeedsSort = true;
+	}
+	else
+	{
+		SortFunctions();
+
+		//Insert after the module's existing hooks so hooks are invoked in the order they were added.
+		m_Hooks.insert(
+			std::upper_bound( m_Hooks.begin(), m_Hooks.end(), hook.pModule, []( const CASModule* pModule, const Hook_t& other )
+			{
+				return HookModuleLess( pModule, other.pModule );
+			} ),
+			hook );
+	}
+
+	pFunction->AddRef();
+
+	if( pFilterObject )
+		pFilterType->GetEngine()->AddRefScriptObject( pFilterObject, pFilterType );
+
+	AddModuleHook( hook.pModule );
+
+	m_DispatchTable.reset();
 
 	return true;
 }
@@ -83,28 +209,155 @@ bool CASBaseEvent::Hook( void* pValue, const int iTypeId )
 	return AddFunction( pFunction );
 }
 
+bool CASBaseEvent::HookFiltered( void* pValue, const int iTypeId, const FilterKey_t filterKey )
+{
+	assert( pValue );
+
+	if( !pValue )
+		return false;
+
+	asIScriptFunction* pFunction = nullptr;
+
+	if( !ValidateHookFunction( iTypeId, pValue, "HookFiltered", pFunction ) )
+	{
+		return false;
+	}
+
+	return AddFunction( pFunction, filterKey );
+}
+
+bool CASBaseEvent::HookFilteredByObject( void* pValue, const int iTypeId, void* pFilterObject, const int iFilterTypeId )
+{
+	assert( pValue );
+
+	if( !pValue )
+		return false;
+
+	//Objects that aren't passed as handles can be copies made for the call, whose address doesn't identify the original.
+	//This also excludes value types, which can't have handles.
+	if( !( iFilterTypeId & asTYPEID_OBJHANDLE ) )
+	{
+		as::Critical( "CBaseEvent::HookFilteredByObject: Filter object must be passed as a handle!\n" );
+		return false;
+	}
+
+	if( pFilterObject )
+	{
+		pFilterObject = *reinterpret_cast<void**>( pFilterObject );
+	}
+
+	if( !pFilterObject )
+	{
+		as::Critical( "CBaseEvent::HookFilteredByObject: Filter object is null!\n" );
+		return false;
+	}
+
+	asIScriptFunction* pFunction = nullptr;
+
+	if( !ValidateHookFunction( iTypeId, pValue, "HookFilteredByObject", pFunction ) )
+	{
+		return false;
+	}
+
+	asITypeInfo* pFilterType = pFunction->GetEngine()->GetTypeInfoById( iFilterTypeId );
+
+	if( !pFilterType )
+	{
+		as::Critical( "CBaseEvent::HookFilteredByObject: Unknown filter object type!\n" );
+		return false;
+	}
+
+	return AddHook( pFunction, true, GetObjectFilterKey( pFilterObject ), pFilterObject, pFilterType );
+}
+
 void CASBaseEvent::RemoveFunction( asIScriptFunction* pFunction )
 {
 	if( !pFunction )
 		return;
 
-	auto it = std::find( m_Functions.begin(), m_Functions.end(), pFunction );
-
-	if( it == m_Functions.end() )
+	if( !m_HookedFunctions.erase( pFunction ) )
 		return;
 
-	( *it )->Release();
+	auto first = m_Hooks.begin();
+	auto last = m_Hooks.end();
 
-	if( IsTriggering() )
+	auto pModule = GetModuleFromScriptFunction( pFunction );
+
+	//Only the module's own hooks need to be searched, unless hooks were appended while sorting was deferred.
+	if( !m_bNeedsSort )
 	{
-		//Currently triggering, mark as removed.
-		*it = nullptr;
+		std::tie( first, last ) = std::equal_range( first, last, Hook_t{ nullptr, pModule }, []( const Hook_t& lhs, const Hook_t& rhs )
+		{
+			return HookModuleLess( lhs.pModule, rhs.pModule );
+		} );
 	}
-	else
+
+	//The function has a hook for each filter key it was added with.
+	auto removed = std::stable_partition( first, last, [ = ]( const Hook_t& hook )
+	{
+		return hook.pFunction != pFunction;
+	} );
+
+	assert( removed != last );
+
+	RetireHookProfile( pFunction );
+
+	for( auto it = removed; it != last; ++it )
 	{
-		//Remove now.
-		m_Functions.erase( it );
+		RemoveModuleHook( it->pModule );
+
+		//Triggers that are in progress keep the function alive through their dispatch table.
+		ReleaseHook( *it );
 	}
+
+	m_Hooks.erase( removed, last );
+
+	m_DispatchTable.reset();
+}
+
+bool CASBaseEvent::AddListener( IASEventListener* pListener, const int iPriority )
+{
+	assert( pListener );
+
+	if( !pListener )
+		return false;
+
+	auto it = std::find_if( m_Listeners.begin(), m_Listeners.end(), [ = ]( const Listener_t& listener )
+	{
+		return listener.pListener == pListener;
+	} );
+
+	if( it != m_Listeners.end() )
+		return true;
+
+	//Insert after listeners with the same priority so they're invoked in the order they were added.
+	m_Listeners.insert(
+		std::upper_bound( m_Listeners.begin(), m_Listeners.end(), iPriority, []( const int iPriority, const Listener_t& listener )
+		{
+			return iPriority > listener.iPriority;
+		} ),
+		Listener_t{ pListener, iPriority } );
+
+	m_DispatchTable.reset();
+
+	return true;
+}
+
+void CASBaseEvent::RemoveListener( IASEventListener* pListener )
+{
+	auto it = std::find_if( m_Listeners.begin(), m_Listeners.end(), [ = ]( const Listener_t& listener )
+	{
+		return listener.pListener == pListener;
+	} );
+
+	if( it == m_Listeners.end() )
+		return;
+
+	m_Listeners.erase( it );
+
+	RetireHookProfile( pListener );
+
+	m_DispatchTable.reset();
 }
 
 void CASBaseEvent::Unhook( void* pValue, const int iTypeId )
@@ -144,19 +397,34 @@ void CASBaseEvent::RemoveFunctionsOfModule( CASModule* pModule )
 	if( !pModule )
 		return;
 
-	//These functions might be null in some edge cases due to hooks being removed in event calls.
-	auto it = std::remove_if( m_Functions.begin(), m_Functions.end(), [ = ]( const asIScriptFunction* pFunction )
+	if( m_ModuleHookCounts.find( pModule ) == m_ModuleHookCounts.end() )
+		return;
+
+	SortFunctions();
+
+	//The module's hooks are contiguous.
+	auto range = std::equal_range( m_Hooks.begin(), m_Hooks.end(), Hook_t{ nullptr, pModule }, []( const Hook_t& lhs, const Hook_t& rhs )
 	{
-		return !pFunction || pModule == GetModuleFromScriptFunction( pFunction );
+		return HookModuleLess( lhs.pModule, rhs.pModule );
 	} );
 
-	for( auto it2 = it; it2 < m_Functions.end(); ++it2 )
+	for( auto it = range.first; it != range.second; ++it )
 	{
-		if( *it2 )
-			( *it2 )->Release();
+		m_HookedFunctions.erase( it->pFunction );
+
+		RetireHookProfile( it->pFunction );
+
+		ReleaseHook( *it );
 	}
 
-	m_Functions.erase( it, m_Functions.end() );
+	m_Hooks.erase( range.first, range.second );
+
+	m_ModuleHookCounts.erase( pModule );
+
+	if( m_pHookListener )
+		m_pHookListener->OnModuleUnhooked( *this, pModule );
+
+	m_DispatchTable.reset();
 }
 
 void CASBaseEvent::RemoveAllFunctions()
@@ -175,15 +443,95 @@ void CASBaseEvent::RemoveAllFunctions()
 		return;
 	}
 
-	for( auto pFunc : m_Functions )
+	for( const auto& hook : m_Hooks )
 	{
+		auto pFunc = hook.pFunction;
+
+		RetireHookProfile( pFunc );
+
 		if( pFunc->GetDelegateFunction() )
 			pFunc->Release();
 
-		pFunc->Release();
+		ReleaseHook( hook );
+	}
+
+	m_Hooks.clear();
+	m_HookedFunctions.clear();
+	m_DispatchTable.reset();
+
+	if( m_pHookListener )
+	{
+		for( const auto& count : m_ModuleHookCounts )
+		{
+			m_pHookListener->OnModuleUnhooked( *this, count.first );
+		}
+	}
+
+	m_ModuleHookCounts.clear();
+}
+
+CASBaseEvent::HookProfiles_t CASBaseEvent::GetHookProfiles() const
+{
+	auto profiles = m_HookProfiles;
+
+	std::stable_sort( profiles.begin(), profiles.end(), []( const HookProfile_t& lhs, const HookProfile_t& rhs )
+	{
+		return lhs.Counters.TotalTime > rhs.Counters.TotalTime;
+	} );
+
+	return profiles;
+}
+
+void CASBaseEvent::ResetProfile()
+{
+	m_Profile = ProfileCounters_t();
+
+	m_HookProfiles.clear();
+	m_HookProfileIndices.clear();
+}
+
+void CASBaseEvent::RecordHookProfile( const DispatchEntry& entry, const ProfileClock_t::duration time, const bool bHandled, const bool bFailed )
+{
+	const void* pHook = entry.pListener ? static_cast<const void*>( entry.pListener ) : entry.pFunction;
+
+	auto result = m_HookProfileIndices.emplace( pHook, m_HookProfiles.size() );
+
+	//First invocation since the hook was added or the profile was reset.
+	if( result.second )
+		m_HookProfiles.push_back( HookProfile_t{ GetHookProfileName( entry ), ProfileCounters_t() } );
+
+	m_HookProfiles[ result.first->second ].Counters.Add( time, bHandled, bFailed );
+}
+
+void CASBaseEvent::DumpProfile( const char* const pszName ) const
+{
+	using Microseconds_t = std::chrono::duration<double, std::micro>;
+
+	if( pszName )
+		as::Msg( "%s\n", pszName );
+
+	as::Msg( "Triggers: %llu, handled: %llu, failed: %llu, total: %.1f us, max: %.1f us\n",
+		static_cast<unsigned long long>( m_Profile.uiCallCount ),
+		static_cast<unsigned long long>( m_Profile.uiHandledCount ),
+		static_cast<unsigned long long>( m_Profile.uiFailedCount ),
+		Microseconds_t( m_Profile.TotalTime ).count(),
+		Microseconds_t( m_Profile.MaxTime ).count() );
+
+	for( const auto& profile : GetHookProfiles() )
+	{
+		const auto& counters = profile.Counters;
+
+		as::Msg( "%s: calls: %llu, handled: %llu, failed: %llu, total: %.1f us, average: %.1f us, max: %.1f us\n",
+			profile.szName.c_str(),
+			static_cast<unsigned long long>( counters.uiCallCount ),
+			static_cast<unsigned long long>( counters.uiHandledCount ),
+			static_cast<unsigned long long>( counters.uiFailedCount ),
+			Microseconds_t( counters.TotalTime ).count(),
+			Microseconds_t( counters.TotalTime ).count() / counters.uiCallCount,
+			Microseconds_t( counters.MaxTime ).count() );
 	}
 
-	m_Functions.clear();
+	as::Msg( "End profile\n" );
 }
 
 bool CASBaseEvent::ValidateHookFunction( const int iTypeId, void* pObject, const char* const pszScope, asIScriptFunction*& pOutFunction ) const
@@ -308,23 +656,157 @@ void CASBaseEvent::DumpHookedFunctions( const char* const pszName ) const
 	as::Msg( "End functions\n" );
 }
 
-void CASBaseEvent::ClearRemovedHooks()
+void CASBaseEvent::SetDeferSort( const bool bDefer )
 {
-	//Can happen when recursively triggering events.
-	if( IsTriggering() )
+	m_bDeferSort = bDefer;
+
+	if( !m_bDeferSort )
+		SortFunctions();
+}
+
+void CASBaseEvent::SortFunctions()
+{
+	if( !m_bNeedsSort )
 		return;
 
-	for( auto it = m_Functions.begin(); it != m_Functions.end(); )
+	std::stable_sort( m_Hooks.begin(), m_Hooks.end(), []( const Hook_t& lhs, const Hook_t& rhs )
+	{
+		return HookModuleLess( lhs.pModule, rhs.pModule );
+	} );
+
+	m_bNeedsSort = false;
+
+	m_DispatchTable.reset();
+}
+
+void CASBaseEvent::UpdateDispatchTable()
+{
+	SortFunctions();
+
+	if( m_DispatchTable )
+		return;
+
+	//Triggers that are in progress keep using their own table, so a new one is made instead of modifying it.
+	auto pTable = new DispatchTable_t();
+
+	pTable->Entries.reserve( m_Listeners.size() + m_Hooks.size() );
+
+	size_t uiOrder = 0;
+	size_t uiGroup = 0;
+
+	//Each listener is treated as its own module for EventStopMode::MODULE_HANDLED.
+	auto addListeners = [ & ]( Listeners_t::const_iterator it, const Listeners_t::const_iterator end )
+	{
+		for( ; it != end; ++it )
+		{
+			pTable->Entries.push_back( DispatchEntry{ nullptr, it->pListener, nullptr, nullptr, uiOrder++, uiGroup++, true } );
+		}
+	};
+
+	auto scriptHooksIt = std::find_if( m_Listeners.begin(), m_Listeners.end(), []( const Listener_t& listener )
 	{
-		if( !( *it ) )
+		return listener.iPriority <= SCRIPT_HOOK_PRIORITY;
+	} );
+
+	addListeners( m_Listeners.begin(), scriptHooksIt );
+
+	for( size_t uiIndex = 0; uiIndex < m_Hooks.size(); ++uiIndex )
+	{
+		const auto& hook = m_Hooks[ uiIndex ];
+
+		auto pFunction = hook.pFunction;
+
+		DispatchEntry entry;
+
+		pFunction->AddRef();
+
+		entry.pFunction = pFunction;
+		entry.pListener = nullptr;
+
+		if( auto pDelegate = pFunction->GetDelegateFunction() )
 		{
-			it = m_Functions.erase( it );
+			entry.pCallee = pDelegate;
+			entry.pObject = pFunction->GetDelegateObject();
 		}
 		else
 		{
-			++it;
+			entry.pCallee = pFunction;
+			entry.pObject = nullptr;
 		}
+
+		if( uiIndex > 0 && hook.pModule != m_Hooks[ uiIndex - 1 ].pModule )
+			++uiGroup;
+
+		entry.uiOrder = uiOrder++;
+		entry.uiGroup = uiGroup;
+
+		entry.bMatchesParams = MatchesParams( *entry.pCallee, m_Params );
+
+		if( hook.bFiltered )
+			pTable->FilteredEntries[ hook.filterKey ].push_back( entry );
+		else
+			pTable->Entries.push_back( entry );
 	}
+
+	if( !m_Hooks.empty() )
+		++uiGroup;
+
+	addListeners( scriptHooksIt, m_Listeners.end() );
+
+	m_DispatchTable.reset( pTable, &::DeleteDispatchTable );
+}
+
+void CASBaseEvent::AddModuleHook( CASModule* pModule )
+{
+	if( ++m_ModuleHookCounts[ pModule ] == 1 && m_pHookListener )
+		m_pHookListener->OnModuleHooked( *this, pModule );
+}
+
+void CASBaseEvent::RemoveModuleHook( CASModule* pModule )
+{
+	auto it = m_ModuleHookCounts.find( pModule );
+
+	assert( it != m_ModuleHookCounts.end() );
+
+	if( it == m_ModuleHookCounts.end() || --it->second > 0 )
+		return;
+
+	m_ModuleHookCounts.erase( it );
+
+	if( m_pHookListener )
+		m_pHookListener->OnModuleUnhooked( *this, pModule );
+}
+
+void CASBaseEvent::ReleaseHook( const Hook_t& hook )
+{
+	if( hook.pFilterObject )
+		hook.pFilterType->GetEngine()->ReleaseScriptObject( hook.pFilterObject, hook.pFilterType );
+
+	hook.pFunction->Release();
+}
+
+bool CASBaseEvent::CanHookFunction( const asIScriptFunction& ASUNREFERENCED( function ) ) const
+{
+	return true;
+}
+
+bool CASBaseEvent::MatchesFuncDefParams( const asIScriptFunction& function ) const
+{
+	return ::MatchesParams( function, m_Params );
+}
+
+ctx::DecodedArguments& CASBaseEvent::GetArgumentBuffer()
+{
+	assert( IsTriggering() );
+
+	const size_t uiDepth = static_cast<size_t>( m_iInCallCount - 1 );
+
+	while( m_ArgumentBuffers.size() <= uiDepth )
+	{
+		m_ArgumentBuffers.emplace_back();
+	}
+
+	return m_ArgumentBuffers[ uiDepth ];
 }
 
 void RegisterScriptCBaseEvent( asIScriptEngine& engine )
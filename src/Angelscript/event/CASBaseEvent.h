@@ -1,15 +1,24 @@
 #ifndef ANGELSCRIPT_CASBASEEVENT_H
 #define ANGELSCRIPT_CASBASEEVENT_H
 
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <angelscript.h>
 
 #include "Angelscript/util/ASUtil.h"
+#include "Angelscript/util/ContextUtils.h"
 
 #include "Angelscript/wrapper/ASCallableConst.h"
 
 class CASModule;
+class IASEventHookListener;
+class IASEventListener;
 
 /**
 *	@defgroup ASEvents Angelscript Events
@@ -17,6 +26,22 @@ class CASModule;
 *	@{
 */
 
+/**
+*	Return codes for functions and listeners that hook into an event.
+*/
+enum class HookReturnCode
+{
+	/**
+	*	Continue executing.
+	*/
+	CONTINUE,
+
+	/**
+	*	The function handled the event, stop.
+	*/
+	HANDLED
+};
+
 /**
 *	Represents an event that can be triggered, and that scripts can hook into to be notified when it is triggered.
 */
@@ -26,8 +51,182 @@ protected:
 	template<typename SUBCLASS, typename EVENTTYPE, typename RETURNTYPE, RETURNTYPE FAILEDRETURNVAL>
 	friend class CASBaseEventCaller;
 
+public:
+	/**
+	*	Priority of script hooks. Listeners with a higher priority are invoked before script hooks, the others after.
+	*/
+	static const int SCRIPT_HOOK_PRIORITY = 0;
+
+	/**
+	*	Key that hooks can be filtered by. Hooks with a filter key are only invoked by triggers that pass the same key.
+	*	Objects are keyed by their address.
+	*/
+	typedef asINT64 FilterKey_t;
+
+	/**
+	*	Precomputed information about a hook, so hooks can be invoked without looking anything up.
+	*/
+	struct DispatchEntry final
+	{
+		/**
+		*	The hooked function. Referenced by the table, so it stays valid even if it's removed while the table is in use.
+		*	Null for native listeners.
+		*/
+		asIScriptFunction* pFunction;
+
+		/**
+		*	The native listener to invoke. Null for script hooks.
+		*/
+		IASEventListener* pListener;
+
+		/**
+		*	The function to prepare. For delegates, this is the delegate's method.
+		*/
+		asIScriptFunction* pCallee;
+
+		/**
+		*	For delegates, the object to call the method on. Null otherwise.
+		*/
+		void* pObject;
+
+		/**
+		*	Position of the entry among all entries, filtered or not. Used to merge filtered entries with unfiltered ones.
+		*/
+		size_t uiOrder;
+
+		/**
+		*	Entries with the same group belong to the same module. Each native listener is its own group.
+		*/
+		size_t uiGroup;
+
+		/**
+		*	Whether the callee takes exactly the funcdef's parameters, so arguments decoded for the event can be used as-is.
+		*	Hooks added with AddFunction are not validated, so this can be false. Always true for native listeners.
+		*/
+		bool bMatchesParams;
+	};
+
+	typedef std::vector<DispatchEntry> DispatchEntries_t;
+
+	/**
+	*	Hooks and listeners in the order they are invoked.
+	*/
+	struct DispatchTable_t final
+	{
+		/**
+		*	Listeners and hooks without a filter key. Invoked by every trigger.
+		*/
+		DispatchEntries_t Entries;
+
+		/**
+		*	Hooks with a filter key, by key. Only invoked by triggers that pass the key.
+		*/
+		std::unordered_map<FilterKey_t, DispatchEntries_t> FilteredEntries;
+	};
+
+	/**
+	*	Immutable snapshot of the hooks. Triggers keep the snapshot they started with alive until they end.
+	*/
+	typedef std::shared_ptr<const DispatchTable_t> DispatchTablePtr_t;
+
+	typedef std::chrono::steady_clock ProfileClock_t;
+
+	/**
+	*	Execution counters for an event or one of its hooks. Only recorded while profiling is enabled.
+	*/
+	struct ProfileCounters_t final
+	{
+		/**
+		*	Number of times the event was triggered, or the hook was invoked.
+		*/
+		uint64_t uiCallCount = 0;
+
+		/**
+		*	Number of calls that handled the event.
+		*/
+		uint64_t uiHandledCount = 0;
+
+		/**
+		*	Number of calls that failed.
+		*/
+		uint64_t uiFailedCount = 0;
+
+		ProfileClock_t::duration TotalTime = ProfileClock_t::duration::zero();
+
+		ProfileClock_t::duration MaxTime = ProfileClock_t::duration::zero();
+
+		/**
+		*	Adds a call to the counters.
+		*/
+		void Add( const ProfileClock_t::duration time, const bool bHandled, const bool bFailed )
+		{
+			++uiCallCount;
+
+			if( bHandled )
+				++uiHandledCount;
+
+			if( bFailed )
+				++uiFailedCount;
+
+			TotalTime += time;
+
+			if( time > MaxTime )
+				MaxTime = time;
+		}
+	};
+
+	/**
+	*	Execution counters for a hook or listener.
+	*/
+	struct HookProfile_t final
+	{
+		/**
+		*	Module and declaration of the function, or the address of the native listener.
+		*/
+		std::string szName;
+
+		ProfileCounters_t Counters;
+	};
+
+	typedef std::vector<HookProfile_t> HookProfiles_t;
+
 private:
-	typedef std::vector<asIScriptFunction*> Functions_t;
+	/**
+	*	A hooked function and the module it belongs to. The module is cached so hooks can be ordered without looking it up.
+	*/
+	struct Hook_t final
+	{
+		asIScriptFunction* pFunction;
+
+		CASModule* pModule;
+
+		bool bFiltered;
+
+		FilterKey_t filterKey;
+
+		/**
+		*	For hooks added with HookFilteredByObject, the object whose address is the filter key.
+		*	A reference is held so the address can't be reused by another object while the hook exists.
+		*/
+		void* pFilterObject;
+		asITypeInfo* pFilterType;
+	};
+
+	typedef std::vector<Hook_t> Hooks_t;
+
+	/**
+	*	Whether each hook of a function is filtered, and its filter key.
+	*/
+	typedef std::unordered_multimap<const asIScriptFunction*, std::pair<bool, FilterKey_t>> HookedFunctions_t;
+
+	struct Listener_t final
+	{
+		IASEventListener* pListener;
+
+		int iPriority;
+	};
+
+	typedef std::vector<Listener_t> Listeners_t;
 
 public:
 	/**
@@ -37,7 +236,7 @@ public:
 	*	@see EventStopMode
 	*/
 	CASBaseEvent( const asDWORD accessMask );
-	~CASBaseEvent();
+	virtual ~CASBaseEvent();
 
 	/**
 	*	@return Access mask.
@@ -50,13 +249,15 @@ public:
 	asIScriptFunction* GetFuncDef() const { return m_pFuncDef; }
 
 	/**
-	*	Sets the funcdef that represents this event.
+	*	Sets the funcdef that represents this event. Caches the funcdef's parameters.
 	*	@param pFuncDef Funcdef.
 	*/
-	void SetFuncDef( asIScriptFunction* pFuncDef )
-	{
-		m_pFuncDef = pFuncDef;
-	}
+	void SetFuncDef( asIScriptFunction* pFuncDef );
+
+	/**
+	*	@return The parameters of the funcdef. Arguments passed to the event are decoded using these.
+	*/
+	const ctx::ParamList_t& GetParamList() const { return m_Params; }
 
 	/**
 	*	@return Number of hooked functions.
@@ -71,13 +272,37 @@ public:
 	asIScriptFunction* GetFunctionByIndex( const size_t uiIndex ) const;
 
 	/**
-	*	Adds a new function. Cannot be called while this event is being called.
+	*	@return The current snapshot of the hooks used by callers, or null if the hooks changed since it was made.
+	*	Entries are in the same order as the hooks. A new snapshot is made when the event is triggered after the hooks change.
+	*/
+	DispatchTablePtr_t GetDispatchTable() const { return m_DispatchTable; }
+
+	/**
+	*	Adds a new function. Can be called while this event is being triggered, in which case it is invoked starting with the next trigger.
 	*	Warning: if the function does not match the event parameters and return type, this will cause problems.
 	*	@param pFunction Function to add.
 	*	@return true if the function was either added or already added before, false otherwise.
 	*/
 	bool AddFunction( asIScriptFunction* pFunction );
 
+	/**
+	*	Adds a new function that is only invoked by triggers that pass the given filter key.
+	*	A function can be added once without a filter key, and once for each filter key.
+	*	@param pFunction Function to add.
+	*	@param filterKey Filter key.
+	*	@return true if the function was either added or already added with this key before, false otherwise.
+	*	@see AddFunction( asIScriptFunction* pFunction )
+	*/
+	bool AddFunction( asIScriptFunction* pFunction, const FilterKey_t filterKey );
+
+	/**
+	*	@return The filter key for the given object. The key is the object's address, so it is only unique while the object exists.
+	*/
+	static FilterKey_t GetObjectFilterKey( const void* pObject )
+	{
+		return static_cast<FilterKey_t>( reinterpret_cast<intptr_t>( pObject ) );
+	}
+
 	/**
 	*	Hooks a function to an event.
 	*	Used by scripts only.
@@ -88,13 +313,37 @@ public:
 	bool Hook( void* pValue, const int iTypeId );
 
 	/**
-	*	Removes a function. Cannot be called while this event is being called.
+	*	Hooks a function to an event. The function is only invoked by triggers that pass the given filter key.
+	*	Used by scripts only.
+	*	@param pValue Function pointer.
+	*	@param iTypeId Function pointer type id.
+	*	@param filterKey Filter key.
+	*	@return true on success, false otherwise.
+	*/
+	bool HookFiltered( void* pValue, const int iTypeId, const FilterKey_t filterKey );
+
+	/**
+	*	Hooks a function to an event. The function is only invoked by triggers that pass the given object's filter key.
+	*	The object must be passed as a handle, so only reference types can be used. A reference to it is held until the hook is removed, so its key can't be reused by another object.
+	*	Types without reference counting must be unhooked before they are destroyed.
+	*	Used by scripts only.
+	*	@param pValue Function pointer.
+	*	@param iTypeId Function pointer type id.
+	*	@param pFilterObject Handle to the object to filter by.
+	*	@param iFilterTypeId Type id of the object.
+	*	@return true on success, false otherwise.
+	*	@see GetObjectFilterKey
+	*/
+	bool HookFilteredByObject( void* pValue, const int iTypeId, void* pFilterObject, const int iFilterTypeId );
+
+	/**
+	*	Removes a function, with all of its filter keys. Can be called while this event is being triggered, in which case triggers that are in progress still invoke it.
 	*	@param pFunction Function to remove.
 	*/
 	void RemoveFunction( asIScriptFunction* pFunction );
 
 	/**
-	*	Unhooks a function from an event.
+	*	Unhooks a function from an event, with all of its filter keys.
 	*	Used by scripts only.
 	*	@param pValue Function pointer.
 	*	@param iTypeId Function pointer type id.
@@ -111,12 +360,138 @@ public:
 	*/
 	void RemoveAllFunctions();
 
+	/**
+	*	@return Number of native listeners.
+	*/
+	size_t GetListenerCount() const { return m_Listeners.size(); }
+
+	/**
+	*	Adds a native listener. Listeners are invoked in order of descending priority, in the order they were added if the priorities are equal.
+	*	The listener must remain valid until it is removed and any triggers that are in progress have ended.
+	*	Can be called while this event is being triggered, in which case it is invoked starting with the next trigger.
+	*	@param pListener Listener to add.
+	*	@param iPriority Priority. Compared against SCRIPT_HOOK_PRIORITY to determine whether it's invoked before or after script hooks.
+	*	@return true if the listener was either added or already added before, false otherwise.
+	*/
+	bool AddListener( IASEventListener* pListener, const int iPriority = SCRIPT_HOOK_PRIORITY );
+
+	/**
+	*	Removes a native listener.
+	*	@param pListener Listener to remove.
+	*/
+	void RemoveListener( IASEventListener* pListener );
+
+	/**
+	*	@return The listener that is notified when modules hook or unhook this event, or null.
+	*/
+	IASEventHookListener* GetHookListener() const { return m_pHookListener; }
+
+	/**
+	*	Sets the listener that is notified when modules hook or unhook this event.
+	*	@param pListener Listener. May be null.
+	*/
+	void SetHookListener( IASEventHookListener* pListener ) { m_pHookListener = pListener; }
+
+	/**
+	*	@return Whether execution counters are recorded when this event is triggered.
+	*/
+	bool IsProfiling() const { return m_bProfiling; }
+
+	/**
+	*	Sets whether execution counters are recorded when this event is triggered. Recorded counters are kept when profiling is turned off.
+	*	@param bProfiling Whether to record execution counters.
+	*/
+	void SetProfiling( const bool bProfiling ) { m_bProfiling = bProfiling; }
+
+	/**
+	*	@return Execution counters for the event as a whole.
+	*/
+	const ProfileCounters_t& GetProfile() const { return m_Profile; }
+
+	/**
+	*	Gets a snapshot of the execution counters for each hook and listener that was invoked while profiling, including ones that have since been removed.
+	*	@return Hook profiles, ordered by descending total time.
+	*/
+	HookProfiles_t GetHookProfiles() const;
+
+	/**
+	*	Resets all execution counters.
+	*/
+	void ResetProfile();
+
+	/**
+	*	Records a trigger of this event. Used by event callers while profiling.
+	*	@param time Time taken by the trigger.
+	*	@param bHandled Whether the event was handled.
+	*	@param bFailed Whether any hook failed.
+	*/
+	void RecordTriggerProfile( const ProfileClock_t::duration time, const bool bHandled, const bool bFailed )
+	{
+		m_Profile.Add( time, bHandled, bFailed );
+	}
+
+	/**
+	*	Records an invocation of a hook. Used by event callers while profiling.
+	*	@param entry Dispatch entry of the hook.
+	*	@param time Time taken by the hook.
+	*	@param bHandled Whether the hook handled the event.
+	*	@param bFailed Whether the hook failed.
+	*/
+	void RecordHookProfile( const DispatchEntry& entry, const ProfileClock_t::duration time, const bool bHandled, const bool bFailed );
+
+	/**
+	*	Dumps the execution counters to stdout, ordered by descending total time.
+	*	@param pszName Optional. Name to print.
+	*/
+	void DumpProfile( const char* const pszName ) const;
+
+	/**
+	*	@return Whether sorting of hooks is deferred.
+	*/
+	bool IsSortDeferred() const { return m_bDeferSort; }
+
+	/**
+	*	Sets whether sorting of hooks is deferred. While deferred, added functions are appended instead of being inserted in order.
+	*	The hooks are sorted when deferring is turned off, or when the event is triggered.
+	*	@param bDefer Whether to defer sorting.
+	*/
+	void SetDeferSort( const bool bDefer );
+
 private:
 	/**
 	*	Validates the given hook function.
 	*/
 	bool ValidateHookFunction( const int iTypeId, void* pObject, const char* const pszScope, asIScriptFunction*& pOutFunction ) const;
 
+	/**
+	*	Adds a hook.
+	*/
+	bool AddHook( asIScriptFunction* pFunction, const bool bFiltered, const FilterKey_t filterKey, void* pFilterObject, asITypeInfo* pFilterType );
+
+	/**
+	*	Releases the data held by a hook that is being removed.
+	*/
+	void ReleaseHook( const Hook_t& hook );
+
+	/**
+	*	Counts a hook for the given module, notifying the listener if it's the module's first hook.
+	*/
+	void AddModuleHook( CASModule* pModule );
+
+	/**
+	*	Removes a hook for the given module from the count, notifying the listener if it was the module's last hook.
+	*/
+	void RemoveModuleHook( CASModule* pModule );
+
+	/**
+	*	Stops recording into the profile of the given hook or listener. Its counters are kept, but a new profile is made if it is added again.
+	*/
+	void RetireHookProfile( const void* pHook )
+	{
+		if( !m_HookProfileIndices.empty() )
+			m_HookProfileIndices.erase( pHook );
+	}
+
 public:
 
 	/**
@@ -156,21 +531,95 @@ protected:
 	}
 
 	/**
-	*	If a script called Unhook while in this event's hook invocation it'll leave behind a null pointer.
-	*	This cleans up those hooks.
+	*	Sorts the hooks if functions were added while sorting was deferred.
+	*/
+	void SortFunctions();
+
+	/**
+	*	Makes a new dispatch table if the hooks changed since the last one was made. Sorts the hooks first if needed.
+	*/
+	void UpdateDispatchTable();
+
+	/**
+	*	@return Buffer to decode arguments into for the current trigger. Each level of recursion gets its own buffer, which is reused by later triggers.
+	*/
+	ctx::DecodedArguments& GetArgumentBuffer();
+
+	/**
+	*	Called after the funcdef has been set, so derived events can check it.
+	*/
+	virtual void OnFuncDefChanged() {}
+
+	/**
+	*	Checks whether a function can be hooked. Any function is allowed by default, since callers can pass arguments that don't match the funcdef.
+	*	@param function Function to check. For delegates, this is the method.
+	*	@return Whether the function can be hooked.
+	*/
+	virtual bool CanHookFunction( const asIScriptFunction& function ) const;
+
+	/**
+	*	@return Whether the function takes exactly the funcdef's parameters.
 	*/
-	void ClearRemovedHooks();
+	bool MatchesFuncDefParams( const asIScriptFunction& function ) const;
 
 private:
 	const asDWORD m_AccessMask;
 
 	asIScriptFunction* m_pFuncDef = nullptr;
 
-	Functions_t m_Functions;
+	ctx::ParamList_t m_Params;
+
+	/**
+	*	One buffer per level of recursion. A deque is used so buffers don't move when a nested trigger adds one.
+	*/
+	std::deque<ctx::DecodedArguments> m_ArgumentBuffers;
+
+	/**
+	*	Hooks, ordered by module.
+	*/
+	Hooks_t m_Hooks;
 
-	//Used to prevent adding/removing hooks while invoking the hook in question.
+	/**
+	*	Filter key of each hook, by function. Used to detect duplicates.
+	*/
+	HookedFunctions_t m_HookedFunctions;
+
+	/**
+	*	Number of hooks for each module that has hooked this event.
+	*/
+	std::unordered_map<CASModule*, size_t> m_ModuleHookCounts;
+
+	IASEventHookListener* m_pHookListener = nullptr;
+
+	/**
+	*	Native listeners, ordered by descending priority.
+	*/
+	Listeners_t m_Listeners;
+
+	/**
+	*	Snapshot of m_Hooks. Reset when the hooks change.
+	*/
+	DispatchTablePtr_t m_DispatchTable;
+
+	//Number of triggers in progress, including recursive ones.
 	int m_iInCallCount = 0;
 
+	ProfileCounters_t m_Profile;
+
+	/**
+	*	Profiles of hooks and listeners, in the order they were first invoked.
+	*/
+	HookProfiles_t m_HookProfiles;
+
+	/**
+	*	Maps hooked functions and listeners to their profile in m_HookProfiles.
+	*/
+	std::unordered_map<const void*, size_t> m_HookProfileIndices;
+
+	bool m_bDeferSort = false;
+	bool m_bNeedsSort = false;
+	bool m_bProfiling = false;
+
 private:
 	CASBaseEvent( const CASBaseEvent& ) = delete;
 	CASBaseEvent& operator=( const CASBaseEvent& ) = delete;
@@ -190,6 +639,14 @@ void RegisterScriptCBaseEvent( asIScriptEngine& engine, const char* const pszObj
 		pszObjectName, "bool Hook(?& in pFunction)",
 		asMETHOD( CLASS, Hook ), asCALL_THISCALL );
 
+	engine.RegisterObjectMethod(
+		pszObjectName, "bool HookFiltered(?& in pFunction, int64 iFilterKey)",
+		asMETHOD( CLASS, HookFiltered ), asCALL_THISCALL );
+
+	engine.RegisterObjectMethod(
+		pszObjectName, "bool HookFilteredByObject(?& in pFunction, ?& in filterObject)",
+		asMETHOD( CLASS, HookFilteredByObject ), asCALL_THISCALL );
+
 	engine.RegisterObjectMethod(
 		pszObjectName, "void Unhook(?& in pFunction)",
 		asMETHOD( CLASS, Unhook ), asCALL_THISCALL );
@@ -15,6 +15,7 @@
 *	A method with this format:
 *	ReturnType_t CallEvent( EventType_t& event, asIScriptContext* pContext, CallFlags_t flags, va_list list )
 *	This method will perform the actual call to the hook.
+*	pContext is null if the event has no script hooks.
 *
 *	@tparam SUBCLASS Class that inherits from this class.
 *	@tparam EVENTTYPE Represents the type of the event being called.
@@ -60,25 +61,16 @@ public:
 
 	/**
 	*	Forwards the call to the subclass.
+	*	The context may be null if the event has no script hooks.
 	*/
 	inline ReturnType_t VCall( EventType_t& event, asIScriptContext* pContext, CallFlags_t flags, va_list list )
 	{
-		//Take care of some common bookkeeping here.
-		assert( pContext );
-
-		if( !pContext )
+		if( !BeginCall( event, pContext ) )
 			return FAILED_RETURN_VALUE;
 
-		IncrementCallCount( event );
-
 		auto result = static_cast<SubClass_t*>( this )->CallEvent( event, pContext, flags, list );
 
-		DecrementCallCount( event );
-
-		assert( GetCallCount( event ) >= 0 );
-
-		//Clear any removed hooks.
-		event.ClearRemovedHooks();
+		EndCall( event );
 
 		return result;
 	}
@@ -96,6 +88,7 @@ public:
 
 	/**
 	*	Calls the given event using a context acquired from the given engine.
+	*	No context is acquired if the event only has native listeners.
 	*	@param event Event to call.
 	*	@param pScriptEngine Script engine to use.
 	*	@param flags Call flags.
@@ -103,11 +96,13 @@ public:
 	*/
 	inline ReturnType_t VCall( EventType_t& event, asIScriptEngine* pScriptEngine, CallFlags_t flags, va_list list )
 	{
-		auto pContext = pScriptEngine->RequestContext();
+		//Events that only have native listeners don't need a context.
+		auto pContext = event.GetFunctionCount() != 0 ? pScriptEngine->RequestContext() : nullptr;
 
 		auto result = VCall( event, pContext, flags, list );
 
-		pScriptEngine->ReturnContext( pContext );
+		if( pContext )
+			pScriptEngine->ReturnContext( pContext );
 
 		return result;
 	}
@@ -120,11 +115,13 @@ public:
 	*/
 	inline ReturnType_t VCall( EventType_t& event, asIScriptEngine* pScriptEngine, va_list list )
 	{
-		auto pContext = pScriptEngine->RequestContext();
+		//Events that only have native listeners don't need a context.
+		auto pContext = event.GetFunctionCount() != 0 ? pScriptEngine->RequestContext() : nullptr;
 
 		auto result = VCall( event, pContext, CallFlag::NONE, list );
 
-		pScriptEngine->ReturnContext( pContext );
+		if( pContext )
+			pScriptEngine->ReturnContext( pContext );
 
 		return result;
 	}
@@ -205,6 +202,38 @@ public:
 	}
 
 protected:
+	/**
+	*	Takes care of common bookkeeping before calling an event's hooks. Must be followed by a call to EndCall if it succeeds.
+	*	@param event Event that is being called.
+	*	@param pContext Context that will be used. May be null if the event has no script hooks.
+	*	@return true if the hooks can be called, false otherwise.
+	*/
+	bool BeginCall( EventType_t& event, asIScriptContext* pContext )
+	{
+		//A context is only needed to call script hooks.
+		assert( pContext || event.GetFunctionCount() == 0 );
+
+		if( !pContext && event.GetFunctionCount() != 0 )
+			return false;
+
+		event.UpdateDispatchTable();
+
+		IncrementCallCount( event );
+
+		return true;
+	}
+
+	/**
+	*	Takes care of common bookkeeping after calling an event's hooks.
+	*	@param event Event that was called.
+	*/
+	void EndCall( EventType_t& event )
+	{
+		DecrementCallCount( event );
+
+		assert( GetCallCount( event ) >= 0 );
+	}
+
 	//These provide access to the event's call counter
 	int GetCallCount( EventType_t& event )
 	{
@@ -220,6 +249,12 @@ protected:
 	{
 		event.DecrementCallCount();
 	}
+
+	//Provides access to the event's argument buffers
+	ctx::DecodedArguments& GetArgumentBuffer( EventType_t& event )
+	{
+		return event.GetArgumentBuffer();
+	}
 };
 
 #endif //ANGELSCRIPT_CASBASEEVENTCALLER_H
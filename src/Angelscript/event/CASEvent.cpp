@@ -19,6 +19,11 @@ void CASEvent::DumpHookedFunctions() const
 	CASBaseEvent::DumpHookedFunctions( ( std::string( "Event \"" ) + GetCategory() + "::" + GetName() + '(' + GetArguments() + ")\"" ).c_str() );
 }
 
+void CASEvent::DumpProfile() const
+{
+	CASBaseEvent::DumpProfile( ( std::string( "Event \"" ) + GetCategory() + "::" + GetName() + '(' + GetArguments() + ")\"" ).c_str() );
+}
+
 void RegisterScriptCEvent( asIScriptEngine& engine )
 {
 	const char* const pszObjectName = "CEvent";
@@ -35,7 +35,7 @@ enum class EventStopMode
 /**
 *	Represents an event that script functions can hook into.
 */
-class CASEvent final : public CASBaseEvent
+class CASEvent : public CASBaseEvent
 {
 public:
 	/**
@@ -74,6 +74,11 @@ public:
 	*/
 	void DumpHookedFunctions() const;
 
+	/**
+	*	Dumps the execution counters to stdout.
+	*/
+	void DumpProfile() const;
+
 private:
 	const char* const m_pszName;
 	const char* const m_pszArguments;
@@ -1,64 +1,105 @@
 #include "CASEventCaller.h"
+#include "IASEventListener.h"
 
-CASEventCaller::ReturnType_t CASEventCaller::CallEvent( EventType_t& event, asIScriptContext* pContext, CallFlags_t flags, va_list list )
+namespace
 {
-	CASContext ctx( *pContext );
-
-	bool bSuccess = true;
-
-	HookReturnCode returnCode = HookReturnCode::CONTINUE;
-
-	asIScriptModule* pLastModule = nullptr;
-
-	decltype( event.GetFunctionByIndex( 0 ) ) pFunc;
+/*
+*	Invokes the hooks of an event.
+*	decode: bool( ctx::DecodedArguments& arguments ), decodes the arguments once, for listeners and hooks that take the event's parameters.
+*	callOther: bool( CASCallable& callable ), calls hooks that don't take the event's parameters.
+*/
+template<typename DECODE, typename CALLOTHER>
+HookCallResult DispatchHooks( CASEvent& event, const CASBaseEvent::FilterKey_t* pFilterKey, asIScriptContext* pContext, CallFlags_t flags,
+	ctx::DecodedArguments& arguments, DECODE&& decode, CALLOTHER&& callOther )
+{
+	bool bDecoded = false;
+	bool bDecodeSucceeded = false;
 
-	for( decltype( event.GetFunctionCount() ) index = 0; index < event.GetFunctionCount(); ++index )
+	return as::DispatchEvent( event, pFilterKey, [ & ]( const CASBaseEvent::DispatchEntry& entry, HookReturnCode& returnCode )
 	{
-		pFunc = event.GetFunctionByIndex( index );
-
-		if( !pFunc )
+		if( entry.bMatchesParams )
 		{
-			//Function was removed in a hook call, skip.
-			continue;
+			if( !bDecoded )
+			{
+				bDecodeSucceeded = decode( arguments );
+				bDecoded = true;
+			}
+
+			if( !bDecodeSucceeded )
+				return false;
 		}
 
-		if( event.GetStopMode() == EventStopMode::MODULE_HANDLED && returnCode == HookReturnCode::HANDLED )
+		if( entry.pListener )
 		{
-			//A hook in the last module handled it, so stop.
-			if( pLastModule && pLastModule != pFunc->GetModule() )
-				break;
-		}
+			const auto listenerReturnCode = entry.pListener->OnEventTriggered( event, arguments );
 
-		pLastModule = pFunc->GetModule();
+			if( returnCode == HookReturnCode::CONTINUE )
+				returnCode = listenerReturnCode;
 
-		CASFunction func( *pFunc, ctx );
+			return true;
+		}
 
-		//The hook might remove itself from the list, so make sure we still have a strong reference.
-		pFunc->AddRef();
+		CASContext ctx( *pContext );
 
-		const auto successCall = func.VCall( flags, list );
+		bool bSuccess;
 
-		pFunc->Release();
+		if( entry.pObject )
+		{
+			CASMethod method( *entry.pCallee, ctx, entry.pObject );
 
-		bSuccess = successCall && bSuccess;
+			bSuccess = entry.bMatchesParams ? as::CallFunction( method, flags, arguments ) : callOther( method );
 
-		//Only check if a HANDLED value was returned if we're still continuing.
-		if( successCall && returnCode == HookReturnCode::CONTINUE )
+			//Only check if a HANDLED value was returned if we're still continuing.
+			if( bSuccess && returnCode == HookReturnCode::CONTINUE )
+				bSuccess = method.GetReturnValue( &returnCode );
+		}
+		else
 		{
-			bSuccess = func.GetReturnValue( &returnCode ) && bSuccess;
+			CASFunction func( *entry.pCallee, ctx );
+
+			bSuccess = entry.bMatchesParams ? as::CallFunction( func, flags, arguments ) : callOther( func );
+
+			if( bSuccess && returnCode == HookReturnCode::CONTINUE )
+				bSuccess = func.GetReturnValue( &returnCode );
 		}
 
-		if( returnCode == HookReturnCode::HANDLED )
+		return bSuccess;
+	} );
+}
+}
+
+CASEventCaller::ReturnType_t CASEventCaller::CallEvent( EventType_t& event, asIScriptContext* pContext, CallFlags_t flags, va_list list )
+{
+	//Decode the arguments once, instead of once for every hook. Hooks that don't take the event's parameters decode them themselves.
+	return DispatchHooks( event, m_bHasFilterKey ? &m_FilterKey : nullptr, pContext, flags, GetArgumentBuffer( event ),
+		[ & ]( ctx::DecodedArguments& arguments )
 		{
-			if( event.GetStopMode() == EventStopMode::ON_HANDLED )
-				break;
-		}
-	}
+			return ctx::DecodeArguments( arguments, event.GetParamList(), list );
+		},
+		[ & ]( auto& callable )
+		{
+			return callable.VCall( flags, list );
+		} );
+}
+
+CASEventCaller::ReturnType_t CASEventCaller::CallArgs( EventType_t& event, asIScriptContext* pContext, CallFlags_t flags, const CASArguments& args )
+{
+	if( !BeginCall( event, pContext ) )
+		return FAILED_RETURN_VALUE;
+
+	auto result = DispatchHooks( event, m_bHasFilterKey ? &m_FilterKey : nullptr, pContext, flags, GetArgumentBuffer( event ),
+		[ & ]( ctx::DecodedArguments& arguments )
+		{
+			return ctx::DecodeArguments( arguments, event.GetParamList(), args );
+		},
+		[ & ]( auto& callable )
+		{
+			return callable.CallArgs( flags, args );
+		} );
 
-	if( !bSuccess )
-		return HookCallResult::FAILED;
+	EndCall( event );
 
-	return returnCode == HookReturnCode::HANDLED ? HookCallResult::HANDLED : HookCallResult::NONE_HANDLED;
+	return result;
 }
 
 void RegisterScriptHookReturnCode( asIScriptEngine& engine )
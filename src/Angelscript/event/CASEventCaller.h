@@ -11,22 +11,6 @@
 *	@{
 */
 
-/**
-*	Return codes for functions that hook into an event.
-*/
-enum class HookReturnCode
-{
-	/**
-	*	Continue executing.
-	*/
-	CONTINUE,
-
-	/**
-	*	The function handled the event, stop.
-	*/
-	HANDLED
-};
-
 /**
 *	Result codes for hook invocation.
 */
@@ -48,6 +32,117 @@ enum class HookCallResult
 	HANDLED
 };
 
+namespace as
+{
+/**
+*	Invokes the hooks of an event in order, stopping as the event's stop mode requires. The event's dispatch table must have been made.
+*	@param event Event whose hooks are invoked. Execution counters are recorded on it if it is profiling.
+*	@param pFilterKey Optional. Filter key of the trigger. Hooks with this filter key are invoked along with hooks without one.
+*		If null, only hooks without a filter key are invoked.
+*	@param callHook Functor with the signature bool( const CASBaseEvent::DispatchEntry& entry, HookReturnCode& returnCode ).
+*		Calls the hook, and if returnCode is CONTINUE, stores the hook's return code in it. Returns whether the call succeeded.
+*	@tparam CALLHOOK Functor type.
+*	@return Result of the invocation.
+*/
+template<typename CALLHOOK>
+HookCallResult DispatchEvent( CASEvent& event, const CASBaseEvent::FilterKey_t* pFilterKey, CALLHOOK&& callHook )
+{
+	//Checked once so the cost when not profiling is a branch per hook.
+	const bool bProfiling = event.IsProfiling();
+
+	const auto triggerStart = bProfiling ? CASBaseEvent::ProfileClock_t::now() : CASBaseEvent::ProfileClock_t::time_point();
+
+	bool bSuccess = true;
+
+	HookReturnCode returnCode = HookReturnCode::CONTINUE;
+
+	//Hold on to the snapshot. Hooks that are added or removed while this runs take effect on the next trigger.
+	const auto pTable = event.GetDispatchTable();
+
+	assert( pTable );
+
+	const auto& entries = pTable->Entries;
+
+	const CASBaseEvent::DispatchEntries_t* pFiltered = nullptr;
+
+	if( pFilterKey )
+	{
+		auto it = pTable->FilteredEntries.find( *pFilterKey );
+
+		if( it != pTable->FilteredEntries.end() )
+			pFiltered = &it->second;
+	}
+
+	const auto stopMode = event.GetStopMode();
+
+	bool bStopAfterGroup = false;
+	size_t uiStopGroup = 0;
+
+	//Merge the filtered entries with the unfiltered ones, in order.
+	for( size_t uiIndex = 0, uiFilteredIndex = 0; ; )
+	{
+		const CASBaseEvent::DispatchEntry* pEntry;
+
+		if( pFiltered && uiFilteredIndex < pFiltered->size() &&
+			( uiIndex >= entries.size() || ( *pFiltered )[ uiFilteredIndex ].uiOrder < entries[ uiIndex ].uiOrder ) )
+		{
+			pEntry = &( *pFiltered )[ uiFilteredIndex++ ];
+		}
+		else if( uiIndex < entries.size() )
+		{
+			pEntry = &entries[ uiIndex++ ];
+		}
+		else
+		{
+			break;
+		}
+
+		//Finished the functions in the module that handled the event.
+		if( bStopAfterGroup && pEntry->uiGroup != uiStopGroup )
+			break;
+
+		if( bProfiling )
+		{
+			const auto previousReturnCode = returnCode;
+
+			const auto hookStart = CASBaseEvent::ProfileClock_t::now();
+
+			const bool bHookSucceeded = callHook( *pEntry, returnCode );
+
+			event.RecordHookProfile( *pEntry, CASBaseEvent::ProfileClock_t::now() - hookStart,
+				previousReturnCode != HookReturnCode::HANDLED && returnCode == HookReturnCode::HANDLED, !bHookSucceeded );
+
+			bSuccess = bHookSucceeded && bSuccess;
+		}
+		else
+		{
+			bSuccess = callHook( *pEntry, returnCode ) && bSuccess;
+		}
+
+		if( returnCode == HookReturnCode::HANDLED )
+		{
+			if( stopMode == EventStopMode::ON_HANDLED )
+				break;
+
+			//Finish the functions in this module, then stop.
+			if( stopMode == EventStopMode::MODULE_HANDLED && !bStopAfterGroup )
+			{
+				bStopAfterGroup = true;
+				uiStopGroup = pEntry->uiGroup;
+			}
+		}
+	}
+
+	if( bProfiling )
+		event.RecordTriggerProfile( CASBaseEvent::ProfileClock_t::now() - triggerStart, returnCode == HookReturnCode::HANDLED, !bSuccess );
+
+	if( !bSuccess )
+		return HookCallResult::FAILED;
+
+	return returnCode == HookReturnCode::HANDLED ? HookCallResult::HANDLED : HookCallResult::NONE_HANDLED;
+}
+}
+
 /**
 *	Class that can call CASEvent classes.
 */
@@ -55,6 +150,48 @@ class CASEventCaller : public CASBaseEventCaller<CASEventCaller, CASEvent, HookC
 {
 public:
 	ReturnType_t CallEvent( EventType_t& event, asIScriptContext* pContext, CallFlags_t flags, va_list list );
+
+	/**
+	*	Calls the given event with stored arguments.
+	*	@param event Event to call.
+	*	@param pContext Context to use. May be null if the event has no script hooks.
+	*	@param flags Call flags.
+	*	@param args Arguments. Must match the event's parameters.
+	*/
+	ReturnType_t CallArgs( EventType_t& event, asIScriptContext* pContext, CallFlags_t flags, const CASArguments& args );
+
+	/**
+	*	@return Whether a filter key is passed to events.
+	*/
+	bool HasFilterKey() const { return m_bHasFilterKey; }
+
+	/**
+	*	@return The filter key passed to events. Only valid if HasFilterKey returns true.
+	*/
+	CASBaseEvent::FilterKey_t GetFilterKey() const { return m_FilterKey; }
+
+	/**
+	*	Sets the filter key to pass to events. Hooks with this filter key are invoked along with hooks without one.
+	*	@param filterKey Filter key.
+	*/
+	void SetFilterKey( const CASBaseEvent::FilterKey_t filterKey )
+	{
+		m_FilterKey = filterKey;
+		m_bHasFilterKey = true;
+	}
+
+	/**
+	*	Stops passing a filter key to events. Only hooks without a filter key are invoked.
+	*/
+	void ClearFilterKey()
+	{
+		m_bHasFilterKey = false;
+	}
+
+private:
+	CASBaseEvent::FilterKey_t m_FilterKey = 0;
+
+	bool m_bHasFilterKey = false;
 };
 
 /**
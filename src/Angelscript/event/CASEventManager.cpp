@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <limits>
+#include <utility>
 
 #include "Angelscript/util/ASUtil.h"
 #include "Angelscript/util/StringUtils.h"
@@ -13,6 +15,14 @@
 
 #include "CASEventManager.h"
 
+namespace
+{
+/*
+*	Number of posts the queue can hold when it's first used.
+*/
+const size_t INITIAL_QUEUE_SIZE = 16;
+}
+
 CASEventManager::CASEventManager( asIScriptEngine& engine, const char* const pszNamespace )
 	: m_Engine( engine )
 {
@@ -27,9 +37,20 @@ CASEventManager::CASEventManager( asIScriptEngine& engine, const char* const psz
 
 CASEventManager::~CASEventManager()
 {
+	//Posted arguments may hold references to script objects.
+	ClearQueue();
+
+	m_FreeArguments.clear();
+
 	m_Engine.Release();
 
 	UnhookAllFunctions();
+
+	//Events may outlive the manager.
+	for( auto pEvent : m_Events )
+	{
+		pEvent->SetHookListener( nullptr );
+	}
 }
 
 CASEvent* CASEventManager::GetEventByIndex( const uint32_t uiIndex )
@@ -100,41 +121,22 @@ CASEvent* CASEventManager::FindEventByName( const std::string& szName )
 		uiAccessMask = pModule->GetDescriptor().GetAccessMask();
 	}
 
+	auto it = m_EventsByName.find( szName );
 
-	auto szNamespace = as::ExtractNamespaceFromName( szName );
-	const auto szEventName = as::ExtractNameFromName( szName );
-
-	if( !m_szNamespace.empty() )
-	{
-		const auto szPrefix = m_szNamespace + "::";
-
-		const auto index = szNamespace.find( szPrefix );
-
-		//If the user specified the event namespace as the namespace, strip it.
-		if( index != std::string::npos )
-		{
-			szNamespace = szNamespace.substr( szPrefix.length() );
-		}
-	}
+	if( it == m_EventsByName.end() )
+		return nullptr;
 
-	for( auto pEvent : m_Events )
-	{
-		if( szNamespace == pEvent->GetCategory() && 
-			szEventName == pEvent->GetName() )
-		{
-			//Access mask must allow use of this event.
-			if( pEvent->GetAccessMask() & uiAccessMask )
-				return pEvent;
+	auto pEvent = it->second;
 
-			as::CASCallerInfo info;
+	//Access mask must allow use of this event.
+	if( pEvent->GetAccessMask() & uiAccessMask )
+		return pEvent;
 
-			as::GetCallerInfo( info, pCtx );
+	as::CASCallerInfo info;
 
-			as::Verbose( "CEventManager::FindEventByName: %s( %d, %d ): Access denied for event \"%s\"\n", info.pszSection, info.iLine, info.iColumn, szName.c_str() );
-			return nullptr;
-		}
-	}
+	as::GetCallerInfo( info, pCtx );
 
+	as::Verbose( "CEventManager::FindEventByName: %s( %d, %d ): Access denied for event \"%s\"\n", info.pszSection, info.iLine, info.iColumn, szName.c_str() );
 	return nullptr;
 }
 
@@ -166,6 +168,7 @@ void CASEventManager::UnhookEvent( const std::string& szName, void* pValue, cons
 		as::GetCallerInfo( info );
 
 		as::Critical( "CEventManager::UnhookEvent: %s(%d, %d): Couldn't find event \"%s\"!\n", info.pszSection, info.iLine, info.iColumn, szName.c_str() );
+		return;
 	}
 
 	pEvent->Unhook( pValue, iTypeId );
@@ -187,6 +190,25 @@ bool CASEventManager::AddEvent( CASEvent* pEvent )
 
 	m_Events.push_back( pEvent );
 
+	pEvent->SetHookListener( this );
+
+	std::string szName;
+
+	if( *pEvent->GetCategory() )
+	{
+		szName = pEvent->GetCategory();
+		szName += "::";
+	}
+
+	szName += pEvent->GetName();
+
+	//If multiple events have the same name, the first one is found.
+	m_EventsByName.emplace( szName, pEvent );
+
+	//The event namespace may optionally be specified.
+	if( !m_szNamespace.empty() )
+		m_EventsByName.emplace( m_szNamespace + "::" + szName, pEvent );
+
 	return true;
 }
 
@@ -248,7 +270,17 @@ void CASEventManager::UnhookModuleFunctions( CASModule* pModule )
 	if( !pModule )
 		return;
 
-	for( auto pEvent : m_Events )
+	auto it = m_HookedEvents.find( pModule );
+
+	if( it == m_HookedEvents.end() )
+		return;
+
+	//Removing the hooks notifies this manager, so take the list out first.
+	const auto events = std::move( it->second );
+
+	m_HookedEvents.erase( it );
+
+	for( auto pEvent : events )
 	{
 		pEvent->RemoveFunctionsOfModule( pModule );
 	}
@@ -262,6 +294,14 @@ void CASEventManager::UnhookAllFunctions()
 	}
 }
 
+void CASEventManager::SetDeferHookSorting( const bool bDefer )
+{
+	for( auto pEvent : m_Events )
+	{
+		pEvent->SetDeferSort( bDefer );
+	}
+}
+
 void CASEventManager::DumpHookedFunctions() const
 {
 	for( auto pEvent : m_Events )
@@ -270,6 +310,273 @@ void CASEventManager::DumpHookedFunctions() const
 	}
 }
 
+void CASEventManager::SetProfiling( const bool bProfiling )
+{
+	for( auto pEvent : m_Events )
+	{
+		pEvent->SetProfiling( bProfiling );
+	}
+}
+
+void CASEventManager::ResetProfiles()
+{
+	for( auto pEvent : m_Events )
+	{
+		pEvent->ResetProfile();
+	}
+}
+
+void CASEventManager::DumpProfiles() const
+{
+	Events_t events;
+
+	std::copy_if( m_Events.begin(), m_Events.end(), std::back_inserter( events ), []( const CASEvent* pEvent )
+	{
+		return pEvent->GetProfile().uiCallCount != 0;
+	} );
+
+	std::stable_sort( events.begin(), events.end(), []( const CASEvent* pLHS, const CASEvent* pRHS )
+	{
+		return pLHS->GetProfile().TotalTime > pRHS->GetProfile().TotalTime;
+	} );
+
+	for( auto pEvent : events )
+	{
+		pEvent->DumpProfile();
+	}
+}
+
+void CASEventManager::OnModuleHooked( CASBaseEvent& event, CASModule* pModule )
+{
+	m_HookedEvents[ pModule ].push_back( &event );
+}
+
+void CASEventManager::OnModuleUnhooked( CASBaseEvent& event, CASModule* pModule )
+{
+	auto it = m_HookedEvents.find( pModule );
+
+	if( it == m_HookedEvents.end() )
+		return;
+
+	auto& events = it->second;
+
+	auto eventIt = std::find( events.begin(), events.end(), &event );
+
+	if( eventIt != events.end() )
+	{
+		*eventIt = events.back();
+		events.pop_back();
+	}
+
+	if( events.empty() )
+		m_HookedEvents.erase( it );
+}
+
+bool CASEventManager::Post( CASEvent* pEvent, ... )
+{
+	va_list list;
+
+	va_start( list, pEvent );
+
+	const bool bResult = VPost( pEvent, false, list );
+
+	va_end( list );
+
+	return bResult;
+}
+
+bool CASEventManager::PostCoalesced( CASEvent* pEvent, ... )
+{
+	va_list list;
+
+	va_start( list, pEvent );
+
+	const bool bResult = VPost( pEvent, true, list );
+
+	va_end( list );
+
+	return bResult;
+}
+
+bool CASEventManager::VPost( CASEvent* pEvent, const bool bCoalesce, va_list list )
+{
+	assert( pEvent );
+
+	if( !pEvent )
+		return false;
+
+	auto pFuncDef = pEvent->GetFuncDef();
+
+	if( !pFuncDef )
+	{
+		as::Critical( "CEventManager::Post: Event \"%s\" has not been registered!\n", pEvent->GetName() );
+		return false;
+	}
+
+	//These would refer to the caller's variables, which may no longer exist when the queue is flushed.
+	for( const auto& param : pEvent->GetParamList() )
+	{
+		if( !( param.iTypeId & ( asTYPEID_OBJHANDLE | asTYPEID_MASK_OBJECT ) ) && ( param.uiFlags & ( asTM_INREF | asTM_OUTREF ) ) )
+		{
+			as::Critical( "CEventManager::Post: Event \"%s\" takes primitives by reference and cannot be posted!\n", pEvent->GetName() );
+			return false;
+		}
+	}
+
+	if( bCoalesce )
+	{
+		auto it = m_CoalescedPosts.find( pEvent );
+
+		if( it != m_CoalescedPosts.end() )
+		{
+			auto& queued = m_Queue[ GetQueueIndex( it->second ) ];
+
+			if( queued.Arguments->SetArguments( *pFuncDef, list ) )
+				return true;
+
+			//The earlier arguments have been cleared, so the post can't be triggered anymore.
+			queued.pEvent = nullptr;
+
+			m_CoalescedPosts.erase( it );
+
+			return false;
+		}
+	}
+
+	CASRefPtr<CASArguments> arguments;
+
+	if( !m_FreeArguments.empty() )
+	{
+		arguments = std::move( m_FreeArguments.back() );
+		m_FreeArguments.pop_back();
+	}
+	else
+	{
+		arguments.Set( new CASArguments(), true );
+	}
+
+	if( !arguments->SetArguments( *pFuncDef, list ) )
+	{
+		m_FreeArguments.push_back( std::move( arguments ) );
+		return false;
+	}
+
+	if( m_uiQueueSize == m_Queue.size() )
+	{
+		//Grow the buffer, moving the posts to the start.
+		EventQueue_t queue( std::max( INITIAL_QUEUE_SIZE, m_Queue.size() * 2 ) );
+
+		for( size_t uiIndex = 0; uiIndex < m_uiQueueSize; ++uiIndex )
+		{
+			queue[ uiIndex ] = std::move( m_Queue[ GetQueueIndex( m_uiQueueHeadSequence + uiIndex ) ] );
+		}
+
+		m_Queue = std::move( queue );
+		m_uiQueueHead = 0;
+	}
+
+	const size_t uiSequence = m_uiQueueHeadSequence + m_uiQueueSize;
+
+	auto& queued = m_Queue[ GetQueueIndex( uiSequence ) ];
+
+	queued.pEvent = pEvent;
+	queued.Arguments = std::move( arguments );
+
+	++m_uiQueueSize;
+
+	if( bCoalesce )
+		m_CoalescedPosts.emplace( pEvent, uiSequence );
+
+	return true;
+}
+
+size_t CASEventManager::Flush()
+{
+	//Hooks can't flush the queue while it's being flushed.
+	if( m_bFlushing )
+		return 0;
+
+	m_bFlushing = true;
+
+	CASEventCaller caller;
+
+	asIScriptContext* pContext = nullptr;
+
+	size_t uiTriggered = 0;
+
+	//Events posted while flushing are left for the next flush. Hooks may clear the queue.
+	for( size_t uiCount = m_uiQueueSize; uiCount > 0 && m_uiQueueSize > 0; --uiCount )
+	{
+		auto queued = PopQueue();
+
+		if( queued.pEvent )
+		{
+			//Only request a context once an event with script hooks is triggered.
+			if( !pContext && queued.pEvent->GetFunctionCount() != 0 )
+				pContext = m_Engine.RequestContext();
+
+			caller.CallArgs( *queued.pEvent, pContext, CallFlag::NONE, *queued.Arguments );
+
+			++uiTriggered;
+		}
+
+		queued.Arguments->Reset();
+
+		m_FreeArguments.push_back( std::move( queued.Arguments ) );
+	}
+
+	if( pContext )
+		m_Engine.ReturnContext( pContext );
+
+	m_bFlushing = false;
+
+	return uiTriggered;
+}
+
+void CASEventManager::ClearQueue()
+{
+	while( m_uiQueueSize > 0 )
+	{
+		auto queued = PopQueue();
+
+		queued.Arguments->Reset();
+
+		m_FreeArguments.push_back( std::move( queued.Arguments ) );
+	}
+}
+
+size_t CASEventManager::GetQueueIndex( const size_t uiSequence ) const
+{
+	return ( m_uiQueueHead + ( uiSequence - m_uiQueueHeadSequence ) ) % m_Queue.size();
+}
+
+CASEventManager::QueuedEvent_t CASEventManager::PopQueue()
+{
+	assert( m_uiQueueSize > 0 );
+
+	auto& slot = m_Queue[ m_uiQueueHead ];
+
+	QueuedEvent_t queued = std::move( slot );
+
+	slot.pEvent = nullptr;
+
+	//Later coalesced posts of this event are queued separately.
+	if( queued.pEvent )
+	{
+		auto it = m_CoalescedPosts.find( queued.pEvent );
+
+		if( it != m_CoalescedPosts.end() && it->second == m_uiQueueHeadSequence )
+			m_CoalescedPosts.erase( it );
+	}
+
+	m_uiQueueHead = ( m_uiQueueHead + 1 ) % m_Queue.size();
+
+	--m_uiQueueSize;
+	++m_uiQueueHeadSequence;
+
+	return queued;
+}
+
 static void RegisterScriptCEventManager( asIScriptEngine& engine )
 {
 	const char* const pszObjectName = "CEventManager";
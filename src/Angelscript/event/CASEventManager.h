@@ -1,12 +1,20 @@
 #ifndef ANGELSCRIPT_CASEVENTMANAGER_H
 #define ANGELSCRIPT_CASEVENTMANAGER_H
 
+#include <cstdarg>
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <angelscript.h>
 
+#include "Angelscript/util/CASRefPtr.h"
+
+#include "Angelscript/wrapper/CASArguments.h"
+
+#include "IASEventHookListener.h"
+
 class asIScriptEngine;
 class CASModule;
 class CASEvent;
@@ -21,10 +29,35 @@ class CASEvent;
 *	Manages a list of global events.
 *	Can store a maximum of UINT32_MAX events.
 */
-class CASEventManager final
+class CASEventManager final : public IASEventHookListener
 {
 private:
 	typedef std::vector<CASEvent*> Events_t;
+	typedef std::unordered_map<std::string, CASEvent*> EventsByName_t;
+	typedef std::unordered_map<CASModule*, std::vector<CASBaseEvent*>> HookedEventsByModule_t;
+
+	/**
+	*	An event that was posted to the queue.
+	*/
+	struct QueuedEvent_t final
+	{
+		/**
+		*	The posted event. Null if the post was dropped.
+		*/
+		CASEvent* pEvent = nullptr;
+
+		/**
+		*	Copy of the arguments.
+		*/
+		CASRefPtr<CASArguments> Arguments;
+	};
+
+	typedef std::vector<QueuedEvent_t> EventQueue_t;
+
+	/**
+	*	Maps events posted with PostCoalesced to the sequence number of their post.
+	*/
+	typedef std::unordered_map<const CASEvent*, size_t> CoalescedPosts_t;
 
 public:
 	/**
@@ -60,6 +93,7 @@ public:
 	*	Finds an event by its name. The given name must specify its category if it has one.
 	*	Format: \<Category\>::\<Name\>
 	*	May optionally specify Events:: as the start of the category.
+	*	Does not allocate memory.
 	*	@return If found, the event. Otherwise, null.
 	*/
 	CASEvent* FindEventByName( const std::string& szName );
@@ -98,7 +132,7 @@ public:
 	void RegisterEvents( asIScriptEngine& engine );
 
 	/**
-	*	Unhooks all functions that are part of the given module.
+	*	Unhooks all functions that are part of the given module. Only the events that the module has hooked are visited.
 	*	@param pModule Module.
 	*/
 	void UnhookModuleFunctions( CASModule* pModule );
@@ -108,11 +142,94 @@ public:
 	*/
 	void UnhookAllFunctions();
 
+	/**
+	*	Sets whether all events defer sorting their hooks.
+	*	@see CASBaseEvent::SetDeferSort
+	*/
+	void SetDeferHookSorting( const bool bDefer );
+
 	/**
 	*	Dumps all hooked functions to stdout.
 	*/
 	void DumpHookedFunctions() const;
 
+	/**
+	*	Sets whether all events record execution counters.
+	*	@see CASBaseEvent::SetProfiling
+	*/
+	void SetProfiling( const bool bProfiling );
+
+	/**
+	*	Resets the execution counters of all events.
+	*/
+	void ResetProfiles();
+
+	/**
+	*	Dumps the execution counters of all events that were triggered while profiling to stdout, ordered by descending total time.
+	*/
+	void DumpProfiles() const;
+
+	/**
+	*	@return The number of events that have been posted, but not yet triggered.
+	*/
+	size_t GetQueuedEventCount() const { return m_uiQueueSize; }
+
+	/**
+	*	Posts an event to the queue, to be triggered by Flush. The arguments are copied.
+	*	Events that take primitives or enums by reference can't be posted.
+	*	@param pEvent Event to post.
+	*	@param ... Arguments.
+	*	@return true if the event was posted, false otherwise.
+	*/
+	bool Post( CASEvent* pEvent, ... );
+
+	/**
+	*	Posts an event to the queue, to be triggered by Flush.
+	*	If the event was already posted with this method and hasn't been triggered yet, that post's arguments are replaced instead.
+	*	The event is triggered once, at the position of the first post.
+	*	@see Post
+	*/
+	bool PostCoalesced( CASEvent* pEvent, ... );
+
+	/**
+	*	Posts an event to the queue, to be triggered by Flush.
+	*	@param pEvent Event to post.
+	*	@param bCoalesce Whether to replace the arguments of an earlier coalesced post of the same event.
+	*	@param list Arguments.
+	*	@return true if the event was posted, false otherwise.
+	*	@see Post
+	*	@see PostCoalesced
+	*/
+	bool VPost( CASEvent* pEvent, const bool bCoalesce, va_list list );
+
+	/**
+	*	Triggers all posted events in the order they were posted. A single context is used for all of them.
+	*	Events that are posted while flushing are triggered by the next call.
+	*	@return The number of events that were triggered.
+	*/
+	size_t Flush();
+
+	/**
+	*	Removes all posted events without triggering them.
+	*/
+	void ClearQueue();
+
+	void OnModuleHooked( CASBaseEvent& event, CASModule* pModule ) override;
+
+	void OnModuleUnhooked( CASBaseEvent& event, CASModule* pModule ) override;
+
+private:
+	/**
+	*	@return Index in the queue of the post with the given sequence number.
+	*/
+	size_t GetQueueIndex( const size_t uiSequence ) const;
+
+	/**
+	*	Removes the first post from the queue.
+	*	@return The post. Its event is null if the post was dropped.
+	*/
+	QueuedEvent_t PopQueue();
+
 private:
 	asIScriptEngine& m_Engine;
 
@@ -120,6 +237,38 @@ private:
 
 	Events_t m_Events;
 
+	/**
+	*	Index of events by qualified name, both with and without the namespace.
+	*/
+	EventsByName_t m_EventsByName;
+
+	/**
+	*	Events that each module has hooked.
+	*/
+	HookedEventsByModule_t m_HookedEvents;
+
+	/**
+	*	Ring buffer of posted events. Grows when full.
+	*/
+	EventQueue_t m_Queue;
+
+	size_t m_uiQueueHead = 0;
+	size_t m_uiQueueSize = 0;
+
+	/**
+	*	Sequence number of the post at the head of the queue. Sequence numbers identify posts regardless of where they are stored.
+	*/
+	size_t m_uiQueueHeadSequence = 0;
+
+	CoalescedPosts_t m_CoalescedPosts;
+
+	/**
+	*	Argument lists of triggered posts, reused by later posts.
+	*/
+	std::vector<CASRefPtr<CASArguments>> m_FreeArguments;
+
+	bool m_bFlushing = false;
+
 private:
 	CASEventManager( const CASEventManager& ) = delete;
 	CASEventManager& operator=( const CASEventManager& ) = delete;
@@ -0,0 +1,509 @@
+#ifndef ANGELSCRIPT_CASTYPEDEVENT_H
+#define ANGELSCRIPT_CASTYPEDEVENT_H
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <angelscript.h>
+
+#include "Angelscript/util/ASLogging.h"
+#include "Angelscript/util/ASUtil.h"
+#include "Angelscript/util/ContextUtils.h"
+
+#include "Angelscript/IASContextResultHandler.h"
+
+#include "CASEvent.h"
+#include "CASEventCaller.h"
+#include "IASEventListener.h"
+
+/**
+*	@addtogroup ASEvents
+*
+*	@{
+*/
+
+namespace as
+{
+/**
+*	Maps a C++ arithmetic type to the type id of the matching primitive type.
+*/
+template<typename T, typename = void>
+struct PrimitiveTypeId;
+
+template<>
+struct PrimitiveTypeId<bool>
+{
+	static const int VALUE = asTYPEID_BOOL;
+};
+
+template<typename T>
+struct PrimitiveTypeId<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+{
+	static const int VALUE =
+		sizeof( T ) == 1 ? ( std::is_signed<T>::value ? asTYPEID_INT8 : asTYPEID_UINT8 ) :
+		sizeof( T ) == 2 ? ( std::is_signed<T>::value ? asTYPEID_INT16 : asTYPEID_UINT16 ) :
+		sizeof( T ) == 4 ? ( std::is_signed<T>::value ? asTYPEID_INT32 : asTYPEID_UINT32 ) :
+		( std::is_signed<T>::value ? asTYPEID_INT64 : asTYPEID_UINT64 );
+};
+
+template<>
+struct PrimitiveTypeId<float>
+{
+	static const int VALUE = asTYPEID_FLOAT;
+};
+
+template<>
+struct PrimitiveTypeId<double>
+{
+	static const int VALUE = asTYPEID_DOUBLE;
+};
+
+/**
+*	Sets a primitive argument on a context, using the setter that matches the size of the type.
+*/
+template<typename T>
+inline int SetPrimitiveArg( asIScriptContext& context, const asUINT uiIndex, const T value )
+{
+	switch( sizeof( T ) )
+	{
+	case 1:		return context.SetArgByte( uiIndex, static_cast<asBYTE>( value ) );
+	case 2:		return context.SetArgWord( uiIndex, static_cast<asWORD>( value ) );
+	case 4:		return context.SetArgDWord( uiIndex, static_cast<asDWORD>( value ) );
+	default:	return context.SetArgQWord( uiIndex, static_cast<asQWORD>( value ) );
+	}
+}
+
+inline int SetPrimitiveArg( asIScriptContext& context, const asUINT uiIndex, const float value )
+{
+	return context.SetArgFloat( uiIndex, value );
+}
+
+inline int SetPrimitiveArg( asIScriptContext& context, const asUINT uiIndex, const double value )
+{
+	return context.SetArgDouble( uiIndex, value );
+}
+
+/**
+*	Stores a primitive argument the same way ctx::DecodeArguments does.
+*/
+template<typename T>
+inline void StorePrimitiveArg( ArgumentValue& value, const T arg )
+{
+	switch( sizeof( T ) )
+	{
+	case 1:		value.byte = static_cast<asBYTE>( arg ); break;
+	case 2:		value.word = static_cast<asWORD>( arg ); break;
+	case 4:		value.dword = static_cast<asDWORD>( arg ); break;
+	default:	value.qword = static_cast<asQWORD>( arg ); break;
+	}
+}
+
+inline void StorePrimitiveArg( ArgumentValue& value, const float arg )
+{
+	value.flValue = arg;
+}
+
+inline void StorePrimitiveArg( ArgumentValue& value, const double arg )
+{
+	value.dValue = arg;
+}
+
+/**
+*	Describes how a C++ type is passed to a script parameter.
+*	Each specialization provides:
+*	static bool Matches( const ctx::ParamInfo& param ): whether the type can be passed to the parameter.
+*	static int Set( asIScriptContext& context, asUINT uiIndex, T value ): sets the argument.
+*	static void Store( ArgumentValue& value, T arg ): stores the argument for native listeners, the same way ctx::DecodeArguments does.
+*
+*	Supported types:
+*	Arithmetic types and enums, passed by value.
+*	Pointers and references to arithmetic types and enums, passed as references (e.g. int& out).
+*	Pointers and references to classes, passed as objects, references to objects or handles.
+*	Object types are not checked beyond being objects, since their type ids are only known at runtime.
+*/
+template<typename T, typename = void>
+struct EventArgTraits;
+
+template<typename T>
+struct EventArgTraits<T, std::enable_if_t<std::is_arithmetic<T>::value>>
+{
+	static bool Matches( const ctx::ParamInfo& param )
+	{
+		return param.iTypeId == PrimitiveTypeId<std::remove_cv_t<T>>::VALUE && !( param.uiFlags & ( asTM_INREF | asTM_OUTREF ) );
+	}
+
+	static int Set( asIScriptContext& context, const asUINT uiIndex, const T value )
+	{
+		return SetPrimitiveArg( context, uiIndex, value );
+	}
+
+	static void Store( ArgumentValue& value, const T arg )
+	{
+		StorePrimitiveArg( value, arg );
+	}
+};
+
+template<typename T>
+struct EventArgTraits<T, std::enable_if_t<std::is_enum<T>::value>>
+{
+	static_assert( sizeof( T ) == sizeof( asDWORD ), "Enums must be 32 bit to be passed to scripts" );
+
+	static bool Matches( const ctx::ParamInfo& param )
+	{
+		return as::IsEnum( param.iTypeId ) && !( param.uiFlags & ( asTM_INREF | asTM_OUTREF ) );
+	}
+
+	static int Set( asIScriptContext& context, const asUINT uiIndex, const T value )
+	{
+		return context.SetArgDWord( uiIndex, static_cast<asDWORD>( value ) );
+	}
+
+	static void Store( ArgumentValue& value, const T arg )
+	{
+		value.dword = static_cast<asDWORD>( arg );
+	}
+};
+
+template<typename T>
+struct EventArgTraits<T*, std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>>
+{
+	static bool Matches( const ctx::ParamInfo& param )
+	{
+		const bool bTypeMatches = std::is_enum<T>::value ? as::IsEnum( param.iTypeId ) : param.iTypeId == PrimitiveTypeId<std::remove_cv_t<T>>::VALUE;
+
+		return bTypeMatches && ( param.uiFlags & ( asTM_INREF | asTM_OUTREF ) );
+	}
+
+	static int Set( asIScriptContext& context, const asUINT uiIndex, T* pValue )
+	{
+		return context.SetArgAddress( uiIndex, const_cast<std::remove_cv_t<T>*>( pValue ) );
+	}
+
+	static void Store( ArgumentValue& value, T* pValue )
+	{
+		value.pValue = const_cast<std::remove_cv_t<T>*>( pValue );
+	}
+};
+
+template<typename T>
+struct EventArgTraits<T*, std::enable_if_t<std::is_class<T>::value>>
+{
+	static bool Matches( const ctx::ParamInfo& param )
+	{
+		return ( param.iTypeId & ( asTYPEID_OBJHANDLE | asTYPEID_MASK_OBJECT ) ) != 0;
+	}
+
+	static int Set( asIScriptContext& context, const asUINT uiIndex, T* pObject )
+	{
+		return context.SetArgObject( uiIndex, const_cast<std::remove_cv_t<T>*>( pObject ) );
+	}
+
+	static void Store( ArgumentValue& value, T* pObject )
+	{
+		value.pValue = const_cast<std::remove_cv_t<T>*>( pObject );
+	}
+};
+
+template<typename T>
+struct EventArgTraits<T&> : public EventArgTraits<T*>
+{
+	static int Set( asIScriptContext& context, const asUINT uiIndex, T& value )
+	{
+		return EventArgTraits<T*>::Set( context, uiIndex, &value );
+	}
+
+	static void Store( ArgumentValue& value, T& arg )
+	{
+		EventArgTraits<T*>::Store( value, &arg );
+	}
+};
+}
+
+/**
+*	An event whose arguments are bound to C++ types at compile time.
+*	The types are checked against the event's funcdef when the event is registered, and are then set on the context directly when triggering.
+*	If they don't match, this is logged once and triggering the event fails.
+*	Hooks must take exactly the funcdef's parameters, since the arguments are passed as-is. Other functions are rejected when they are hooked.
+*	Usage:
+*	CASTypedEvent<const std::string&, bool> event( "Main", "const string& in, bool", "", ModuleAccessMask::ALL, EventStopMode::ON_HANDLED );
+*	event.Trigger( pEngine, szString, true );
+*	@tparam ARGS Argument types. See as::EventArgTraits for supported types.
+*/
+template<typename... ARGS>
+class CASTypedEvent final : public CASEvent
+{
+public:
+	using CASEvent::CASEvent;
+
+	/**
+	*	@return Whether the argument types match the event's funcdef. False if the event has not been registered.
+	*/
+	bool Validate() const { return m_bValid; }
+
+	/**
+	*	Triggers the event using the given context.
+	*	@param pContext Context to use. May be null if the event has no script hooks.
+	*	@param args Arguments.
+	*	@return Result of the invocation.
+	*/
+	HookCallResult Trigger( asIScriptContext* pContext, ARGS... args )
+	{
+		return Dispatch( pContext, nullptr, args... );
+	}
+
+	/**
+	*	Triggers the event without a context. Only valid if the event has no script hooks.
+	*	@param args Arguments.
+	*	@return Result of the invocation.
+	*/
+	HookCallResult Trigger( std::nullptr_t, ARGS... args )
+	{
+		return Dispatch( nullptr, nullptr, args... );
+	}
+
+	/**
+	*	Triggers the event using a context acquired from the given engine.
+	*	No context is acquired if the event only has native listeners.
+	*	@param pScriptEngine Script engine to use.
+	*	@param args Arguments.
+	*	@return Result of the invocation.
+	*/
+	HookCallResult Trigger( asIScriptEngine* pScriptEngine, ARGS... args )
+	{
+		auto pContext = GetFunctionCount() != 0 ? pScriptEngine->RequestContext() : nullptr;
+
+		auto result = Trigger( pContext, args... );
+
+		if( pContext )
+			pScriptEngine->ReturnContext( pContext );
+
+		return result;
+	}
+
+	/**
+	*	Triggers the event using the given context. Hooks with the given filter key are invoked along with hooks without one.
+	*	@param pContext Context to use. May be null if the event has no script hooks.
+	*	@param filterKey Filter key.
+	*	@param args Arguments.
+	*	@return Result of the invocation.
+	*	@see CASBaseEvent::HookFiltered
+	*/
+	HookCallResult TriggerFiltered( asIScriptContext* pContext, const FilterKey_t filterKey, ARGS... args )
+	{
+		return Dispatch( pContext, &filterKey, args... );
+	}
+
+	/**
+	*	Triggers the event without a context. Hooks with the given filter key are invoked along with hooks without one.
+	*	Only valid if the event has no script hooks.
+	*	@param filterKey Filter key.
+	*	@param args Arguments.
+	*	@return Result of the invocation.
+	*/
+	HookCallResult TriggerFiltered( std::nullptr_t, const FilterKey_t filterKey, ARGS... args )
+	{
+		return Dispatch( nullptr, &filterKey, args... );
+	}
+
+	/**
+	*	Triggers the event using a context acquired from the given engine. Hooks with the given filter key are invoked along with hooks without one.
+	*	No context is acquired if the event only has native listeners.
+	*	@param pScriptEngine Script engine to use.
+	*	@param filterKey Filter key.
+	*	@param args Arguments.
+	*	@return Result of the invocation.
+	*	@see CASBaseEvent::HookFiltered
+	*/
+	HookCallResult TriggerFiltered( asIScriptEngine* pScriptEngine, const FilterKey_t filterKey, ARGS... args )
+	{
+		auto pContext = GetFunctionCount() != 0 ? pScriptEngine->RequestContext() : nullptr;
+
+		auto result = TriggerFiltered( pContext, filterKey, args... );
+
+		if( pContext )
+			pScriptEngine->ReturnContext( pContext );
+
+		return result;
+	}
+
+protected:
+	void OnFuncDefChanged() override;
+
+	bool CanHookFunction( const asIScriptFunction& function ) const override;
+
+private:
+	HookCallResult Dispatch( asIScriptContext* pContext, const FilterKey_t* pFilterKey, ARGS... args );
+
+	template<size_t... INDICES>
+	bool MatchesParams( std::index_sequence<INDICES...> ) const
+	{
+		const auto& params = GetParamList();
+
+		const bool matches[] = { true, as::EventArgTraits<ARGS>::Matches( params[ INDICES ] )... };
+
+		for( auto bMatches : matches )
+		{
+			if( !bMatches )
+				return false;
+		}
+
+		return true;
+	}
+
+	template<size_t... INDICES>
+	void StoreArguments( ctx::DecodedArguments& arguments, std::index_sequence<INDICES...>, ARGS... args ) const
+	{
+		arguments.Values.resize( sizeof...( ARGS ) );
+
+		const int dummy[] = { 0, ( as::EventArgTraits<ARGS>::Store( arguments.Values[ INDICES ], args ), 0 )... };
+
+		static_cast<void>( dummy );
+
+		arguments.pParams = &GetParamList();
+	}
+
+	template<size_t... INDICES>
+	static bool SetArguments( asIScriptContext& context, std::index_sequence<INDICES...>, ARGS... args )
+	{
+		const int results[] = { 0, as::EventArgTraits<ARGS>::Set( context, static_cast<asUINT>( INDICES ), args )... };
+
+		for( auto iResult : results )
+		{
+			if( iResult < 0 )
+				return false;
+		}
+
+		return true;
+	}
+
+private:
+	bool m_bValid = false;
+};
+
+template<typename... ARGS>
+void CASTypedEvent<ARGS...>::OnFuncDefChanged()
+{
+	if( !GetFuncDef() )
+	{
+		m_bValid = false;
+		return;
+	}
+
+	m_bValid = GetParamList().size() == sizeof...( ARGS ) && MatchesParams( std::index_sequence_for<ARGS...>() );
+
+	if( !m_bValid )
+	{
+		as::Critical( "CASTypedEvent::OnFuncDefChanged: Argument types for event \"%s\" do not match its parameters \"%s\"!\n", GetName(), GetArguments() );
+		return;
+	}
+
+	//Hooks added before the event was registered couldn't be checked yet. They are skipped when the event is triggered.
+	for( size_t uiIndex = 0; uiIndex < GetFunctionCount(); ++uiIndex )
+	{
+		auto pFunction = GetFunctionByIndex( uiIndex );
+
+		CanHookFunction( pFunction->GetDelegateFunction() ? *pFunction->GetDelegateFunction() : *pFunction );
+	}
+}
+
+template<typename... ARGS>
+bool CASTypedEvent<ARGS...>::CanHookFunction( const asIScriptFunction& function ) const
+{
+	//Checked when the event is registered.
+	if( !GetFuncDef() )
+		return true;
+
+	if( !MatchesFuncDefParams( function ) )
+	{
+		as::Critical( "CASTypedEvent::CanHookFunction: Function \"%s\" does not match the parameters of event \"%s\"!\n", function.GetName(), GetName() );
+		return false;
+	}
+
+	return true;
+}
+
+template<typename... ARGS>
+HookCallResult CASTypedEvent<ARGS...>::Dispatch( asIScriptContext* pContext, const FilterKey_t* pFilterKey, ARGS... args )
+{
+	//A context is only needed to call script hooks.
+	assert( pContext || GetFunctionCount() == 0 );
+
+	//Mismatched arguments were reported when the event was registered.
+	assert( GetFuncDef() );
+
+	if( ( !pContext && GetFunctionCount() != 0 ) || !m_bValid )
+		return HookCallResult::FAILED;
+
+	UpdateDispatchTable();
+
+	IncrementCallCount();
+
+	auto pResultHandler = pContext ? as::GetContextResultHandler( *pContext ) : nullptr;
+
+	ctx::DecodedArguments* pArguments = nullptr;
+
+	auto result = as::DispatchEvent( *this, pFilterKey, [ & ]( const DispatchEntry& entry, HookReturnCode& returnCode )
+	{
+		if( entry.pListener )
+		{
+			//Listeners take the arguments the same way the caller decodes them, so store them once.
+			if( !pArguments )
+			{
+				pArguments = &GetArgumentBuffer();
+
+				StoreArguments( *pArguments, std::index_sequence_for<ARGS...>(), args... );
+			}
+
+			const auto listenerReturnCode = entry.pListener->OnEventTriggered( *this, *pArguments );
+
+			if( returnCode == HookReturnCode::CONTINUE )
+				returnCode = listenerReturnCode;
+
+			return true;
+		}
+
+		//Only hooks added before the event was registered can mismatch, and those were reported then. Passing these arguments to them could corrupt the stack.
+		if( !entry.bMatchesParams )
+			return false;
+
+		auto iResult = pContext->Prepare( entry.pCallee );
+
+		if( pResultHandler )
+			pResultHandler->ProcessPrepareResult( *entry.pCallee, *pContext, iResult );
+
+		if( iResult < 0 )
+			return false;
+
+		if( entry.pObject && pContext->SetObject( entry.pObject ) < 0 )
+			return false;
+
+		if( !SetArguments( *pContext, std::index_sequence_for<ARGS...>(), args... ) )
+			return false;
+
+		iResult = pContext->Execute();
+
+		if( pResultHandler )
+			pResultHandler->ProcessExecuteResult( *entry.pCallee, *pContext, iResult );
+
+		if( iResult != asEXECUTION_FINISHED )
+			return false;
+
+		//Only check if a HANDLED value was returned if we're still continuing.
+		if( returnCode == HookReturnCode::CONTINUE )
+			returnCode = static_cast<HookReturnCode>( pContext->GetReturnDWord() );
+
+		return true;
+	} );
+
+	DecrementCallCount();
+
+	assert( GetCallCount() >= 0 );
+
+	return result;
+}
+
+/** @} */
+
+#endif //ANGELSCRIPT_CASTYPEDEVENT_H
@@ -0,0 +1,46 @@
+#ifndef ANGELSCRIPT_IASEVENTHOOKLISTENER_H
+#define ANGELSCRIPT_IASEVENTHOOKLISTENER_H
+
+class CASBaseEvent;
+class CASModule;
+
+/**
+*	@addtogroup ASEvents
+*
+*	@{
+*/
+
+/**
+*	Interface used by events to report which modules have hooks in them.
+*	Used by CASEventManager to find the events that a module has hooked without visiting every event.
+*/
+class IASEventHookListener
+{
+public:
+	/**
+	*	Destructor.
+	*/
+	virtual ~IASEventHookListener() = 0;
+
+	/**
+	*	Called when the first hook that belongs to a module is added to an event.
+	*	@param event Event that was hooked.
+	*	@param pModule Module that the hook belongs to.
+	*/
+	virtual void OnModuleHooked( CASBaseEvent& event, CASModule* pModule ) = 0;
+
+	/**
+	*	Called when the last hook that belongs to a module is removed from an event.
+	*	@param event Event that was unhooked.
+	*	@param pModule Module that the hook belonged to.
+	*/
+	virtual void OnModuleUnhooked( CASBaseEvent& event, CASModule* pModule ) = 0;
+};
+
+inline IASEventHookListener::~IASEventHookListener()
+{
+}
+
+/** @} */
+
+#endif //ANGELSCRIPT_IASEVENTHOOKLISTENER_H
@@ -0,0 +1,41 @@
+#ifndef ANGELSCRIPT_IASEVENTLISTENER_H
+#define ANGELSCRIPT_IASEVENTLISTENER_H
+
+#include "Angelscript/util/ContextUtils.h"
+
+#include "CASBaseEvent.h"
+
+/**
+*	@addtogroup ASEvents
+*
+*	@{
+*/
+
+/**
+*	Interface for native listeners that are invoked along with an event's script hooks.
+*	@see CASBaseEvent::AddListener
+*/
+class IASEventListener
+{
+public:
+	/**
+	*	Destructor.
+	*/
+	virtual ~IASEventListener() = 0;
+
+	/**
+	*	Called when the event is triggered.
+	*	@param event Event that was triggered.
+	*	@param arguments Arguments passed to the event, stored as described by event.GetParamList().
+	*	@return Whether the listener handled the event.
+	*/
+	virtual HookReturnCode OnEventTriggered( CASBaseEvent& event, const ctx::DecodedArguments& arguments ) = 0;
+};
+
+inline IASEventListener::~IASEventListener()
+{
+}
+
+/** @} */
+
+#endif //ANGELSCRIPT_IASEVENTLISTENER_H
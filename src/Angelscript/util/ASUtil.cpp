@@ -1,6 +1,12 @@
+#include <chrono>
 #include <cstdint>
 #include <memory>
 
+#ifndef WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
 #include "Angelscript/add_on/scriptany.h"
 
 #include "ASUtil.h"
@@ -438,4 +444,46 @@ bool CreateFunctionSignature(
 
 	return bSuccess;
 }
-}
\ No newline at end of file
+
+bool GetFileInfo( const char* const pszFilename, int64_t& iModificationTime, uint64_t& uiSize )
+{
+	assert( pszFilename );
+
+#ifdef WIN32
+	WIN32_FILE_ATTRIBUTE_DATA data;
+
+	if( !GetFileAttributesExA( pszFilename, GetFileExInfoStandard, &data ) )
+		return false;
+
+	//FILETIME is in 100 nanosecond intervals since 1601.
+	const uint64_t uiWriteTime = ( static_cast<uint64_t>( data.ftLastWriteTime.dwHighDateTime ) << 32 ) | data.ftLastWriteTime.dwLowDateTime;
+	const uint64_t uiEpochOffset = 116444736000000000ULL;
+
+	iModificationTime = static_cast<int64_t>( uiWriteTime - uiEpochOffset ) * 100;
+	uiSize = ( static_cast<uint64_t>( data.nFileSizeHigh ) << 32 ) | data.nFileSizeLow;
+#else
+	struct stat info;
+
+	if( stat( pszFilename, &info ) != 0 )
+		return false;
+
+#ifdef __APPLE__
+	const auto& modificationTime = info.st_mtimespec;
+#else
+	const auto& modificationTime = info.st_mtim;
+#endif
+
+	iModificationTime = static_cast<int64_t>( modificationTime.tv_sec ) * 1000000000 + static_cast<int64_t>( modificationTime.tv_nsec );
+	uiSize = static_cast<uint64_t>( info.st_size );
+#endif
+
+	return true;
+}
+
+bool IsRecentModification( const int64_t iModificationTime )
+{
+	const int64_t iNow = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+
+	return iNow - iModificationTime < RECENT_MODIFICATION_WINDOW;
+}
+}
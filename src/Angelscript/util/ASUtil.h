@@ -463,6 +463,38 @@ struct CASMethodIterator final
 	}
 };
 
+/**
+*	Iterates over a single function. Lets FindFunction check arguments against a function that is already known.
+*/
+struct CASSingleFunctionIterator final
+{
+	asIScriptFunction& function;
+
+	/**
+	*	Constructor.
+	*	@param function Function.
+	*/
+	CASSingleFunctionIterator( asIScriptFunction& function )
+		: function( function )
+	{
+	}
+
+	/**
+	*	@return Number of functions.
+	*/
+	asUINT GetCount() const { return 1; }
+
+	/**
+	*	Gets a function by index.
+	*	@param uiIndex Function index.
+	*	@return Function.
+	*/
+	asIScriptFunction* GetByIndex( const asUINT ) const
+	{
+		return &function;
+	}
+};
+
 /**
 *	Finds a function by name and argument types.
 *	@param engine Script engine.
@@ -997,6 +1029,28 @@ inline bool FormatFunctionName( const asIScriptFunction& function, char* pszDest
 
 	return true;
 }
+
+/**
+*	Gets the modification time and size of a file.
+*	@param pszFilename Name of the file.
+*	@param[ out ] iModificationTime Modification time in nanoseconds since the epoch. The actual precision depends on the file system.
+*	@param[ out ] uiSize Size of the file in bytes.
+*	@return true if the file exists and its information could be retrieved, false otherwise.
+*/
+bool GetFileInfo( const char* const pszFilename, int64_t& iModificationTime, uint64_t& uiSize );
+
+/**
+*	Files modified this recently may change again without their modification time changing,
+*	either because the file system has coarse timestamps or because the file is still being written. In nanoseconds.
+*/
+const int64_t RECENT_MODIFICATION_WINDOW = 2000000000;
+
+/**
+*	@param iModificationTime Modification time as returned by GetFileInfo.
+*	@return Whether the modification time is too recent to be used to detect later changes.
+*	@see RECENT_MODIFICATION_WINDOW
+*/
+bool IsRecentModification( const int64_t iModificationTime );
 }
 
 /** @} */
@@ -0,0 +1,65 @@
+#include <cassert>
+#include <cstring>
+
+#include "CASFileBinaryStream.h"
+
+CASFileBinaryStream::CASFileBinaryStream( const char* const pszFilename, const Mode mode )
+	: m_File( nullptr, ::fclose )
+{
+	assert( pszFilename );
+
+	if( !pszFilename )
+		return;
+
+	m_File.reset( fopen( pszFilename, mode == Mode::READ ? "rb" : "wb" ) );
+}
+
+size_t CASFileBinaryStream::GetRemainingBytes() const
+{
+	if( !m_File )
+		return 0;
+
+	const long iCurrent = ftell( m_File.get() );
+
+	if( iCurrent < 0 || fseek( m_File.get(), 0, SEEK_END ) != 0 )
+		return 0;
+
+	const long iEnd = ftell( m_File.get() );
+
+	fseek( m_File.get(), iCurrent, SEEK_SET );
+
+	return iEnd > iCurrent ? static_cast<size_t>( iEnd - iCurrent ) : 0;
+}
+
+bool CASFileBinaryStream::Close()
+{
+	if( !m_File )
+		return !m_bFailed;
+
+	if( fclose( m_File.release() ) != 0 )
+		m_bFailed = true;
+
+	return !m_bFailed;
+}
+
+void CASFileBinaryStream::Read( void* pData, asUINT uiSize )
+{
+	if( !uiSize )
+		return;
+
+	if( !m_File || m_bFailed || fread( pData, uiSize, 1, m_File.get() ) != 1 )
+	{
+		//Angelscript has no way to report read errors, so give it zeroes and let the caller check the failed state.
+		memset( pData, 0, uiSize );
+		m_bFailed = true;
+	}
+}
+
+void CASFileBinaryStream::Write( const void* pData, asUINT uiSize )
+{
+	if( !uiSize )
+		return;
+
+	if( !m_File || m_bFailed || fwrite( pData, uiSize, 1, m_File.get() ) != 1 )
+		m_bFailed = true;
+}
@@ -0,0 +1,67 @@
+#ifndef ANGELSCRIPT_UTIL_CASFILEBINARYSTREAM_H
+#define ANGELSCRIPT_UTIL_CASFILEBINARYSTREAM_H
+
+#include <cstdio>
+#include <memory>
+
+#include <angelscript.h>
+
+/**
+*	Binary stream that reads from or writes to a file.
+*	Used to save and load module bytecode.
+*/
+class CASFileBinaryStream final : public asIBinaryStream
+{
+public:
+	enum class Mode
+	{
+		READ,
+		WRITE
+	};
+
+public:
+	/**
+	*	Opens the given file.
+	*	@param pszFilename Name of the file to open.
+	*	@param mode Whether to open the file for reading or writing. Files opened for writing are truncated.
+	*/
+	CASFileBinaryStream( const char* const pszFilename, const Mode mode );
+
+	~CASFileBinaryStream() = default;
+
+	/**
+	*	@return Whether the file is open.
+	*/
+	bool IsOpen() const { return !!m_File; }
+
+	/**
+	*	@return Whether a read or write operation failed. Failed reads zero fill the destination buffer.
+	*/
+	bool HasFailed() const { return m_bFailed; }
+
+	/**
+	*	@return The number of bytes left to read, or 0 if the file isn't open.
+	*/
+	size_t GetRemainingBytes() const;
+
+	/**
+	*	Closes the file.
+	*	@return Whether all writes made it to disk.
+	*/
+	bool Close();
+
+	void Read( void* pData, asUINT uiSize ) override;
+
+	void Write( const void* pData, asUINT uiSize ) override;
+
+private:
+	std::unique_ptr<FILE, int ( * )( FILE* )> m_File;
+
+	bool m_bFailed = false;
+
+private:
+	CASFileBinaryStream( const CASFileBinaryStream& ) = delete;
+	CASFileBinaryStream& operator=( const CASFileBinaryStream& ) = delete;
+};
+
+#endif //ANGELSCRIPT_UTIL_CASFILEBINARYSTREAM_H
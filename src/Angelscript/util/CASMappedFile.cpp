@@ -0,0 +1,116 @@
+#include <cassert>
+#include <utility>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "ASPlatform.h"
+
+#include "CASMappedFile.h"
+
+CASMappedFile::CASMappedFile( const char* const pszFilename )
+{
+	Open( pszFilename );
+}
+
+CASMappedFile::~CASMappedFile()
+{
+	Close();
+}
+
+CASMappedFile::CASMappedFile( CASMappedFile&& other )
+	: m_pData( other.m_pData )
+	, m_uiSize( other.m_uiSize )
+{
+	other.m_pData = nullptr;
+	other.m_uiSize = 0;
+}
+
+CASMappedFile& CASMappedFile::operator=( CASMappedFile&& other )
+{
+	if( this != &other )
+	{
+		Close();
+
+		std::swap( m_pData, other.m_pData );
+		std::swap( m_uiSize, other.m_uiSize );
+	}
+
+	return *this;
+}
+
+bool CASMappedFile::Open( const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	Close();
+
+	if( !pszFilename )
+		return false;
+
+#ifdef WIN32
+	HANDLE hFile = CreateFileA( pszFilename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+
+	if( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER size;
+
+	if( GetFileSizeEx( hFile, &size ) && size.QuadPart > 0 )
+	{
+		if( HANDLE hMapping = CreateFileMappingA( hFile, nullptr, PAGE_READONLY, 0, 0, nullptr ) )
+		{
+			m_pData = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+
+			//The view keeps the mapping alive.
+			CloseHandle( hMapping );
+
+			if( m_pData )
+				m_uiSize = static_cast<size_t>( size.QuadPart );
+		}
+	}
+
+	CloseHandle( hFile );
+#else
+	const int iFile = open( pszFilename, O_RDONLY );
+
+	if( iFile == -1 )
+		return false;
+
+	struct stat info;
+
+	if( fstat( iFile, &info ) == 0 && info.st_size > 0 )
+	{
+		void* pData = mmap( nullptr, static_cast<size_t>( info.st_size ), PROT_READ, MAP_PRIVATE, iFile, 0 );
+
+		if( pData != MAP_FAILED )
+		{
+			m_pData = pData;
+			m_uiSize = static_cast<size_t>( info.st_size );
+		}
+	}
+
+	//The mapping keeps the file alive.
+	close( iFile );
+#endif
+
+	return IsOpen();
+}
+
+void CASMappedFile::Close()
+{
+	if( !m_pData )
+		return;
+
+#ifdef WIN32
+	UnmapViewOfFile( m_pData );
+#else
+	munmap( const_cast<void*>( m_pData ), m_uiSize );
+#endif
+
+	m_pData = nullptr;
+	m_uiSize = 0;
+}
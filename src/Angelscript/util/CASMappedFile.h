@@ -0,0 +1,61 @@
+#ifndef ANGELSCRIPT_UTIL_CASMAPPEDFILE_H
+#define ANGELSCRIPT_UTIL_CASMAPPEDFILE_H
+
+#include <cstddef>
+
+/**
+*	A read only view of a file mapped into memory.
+*/
+class CASMappedFile final
+{
+public:
+	CASMappedFile() = default;
+
+	/**
+	*	Maps the given file.
+	*	@see Open
+	*/
+	CASMappedFile( const char* const pszFilename );
+
+	~CASMappedFile();
+
+	CASMappedFile( CASMappedFile&& other );
+	CASMappedFile& operator=( CASMappedFile&& other );
+
+	/**
+	*	@return Whether a file is mapped. Empty files are never mapped.
+	*/
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	/**
+	*	@return The mapped data.
+	*/
+	const void* GetData() const { return m_pData; }
+
+	/**
+	*	@return The size of the mapped data, in bytes.
+	*/
+	size_t GetSize() const { return m_uiSize; }
+
+	/**
+	*	Maps a file. If a file is already mapped, it is unmapped first.
+	*	@param pszFilename Name of the file to map.
+	*	@return Whether the file was mapped.
+	*/
+	bool Open( const char* const pszFilename );
+
+	/**
+	*	Unmaps the file, if one is mapped.
+	*/
+	void Close();
+
+private:
+	const void* m_pData = nullptr;
+	size_t m_uiSize = 0;
+
+private:
+	CASMappedFile( const CASMappedFile& ) = delete;
+	CASMappedFile& operator=( const CASMappedFile& ) = delete;
+};
+
+#endif //ANGELSCRIPT_UTIL_CASMAPPEDFILE_H
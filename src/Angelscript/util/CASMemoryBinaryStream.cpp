@@ -0,0 +1,42 @@
+#include <cassert>
+#include <cstring>
+
+#include "CASMemoryBinaryStream.h"
+
+CASMemoryBinaryStream::CASMemoryBinaryStream( const void* pData, const size_t uiSize )
+	: m_pData( reinterpret_cast<const char*>( pData ) )
+	, m_uiSize( pData ? uiSize : 0 )
+{
+}
+
+void CASMemoryBinaryStream::Read( void* pData, asUINT uiSize )
+{
+	if( !uiSize )
+		return;
+
+	if( m_bFailed || uiSize > GetRemainingBytes() )
+	{
+		//Angelscript has no way to report read errors, so give it zeroes and let the caller check the failed state.
+		memset( pData, 0, uiSize );
+		m_bFailed = true;
+		return;
+	}
+
+	memcpy( pData, m_pData + m_uiPosition, uiSize );
+
+	m_uiPosition += uiSize;
+}
+
+void CASMemoryBinaryStream::Write( const void* pData, asUINT uiSize )
+{
+	if( m_pData )
+	{
+		assert( !"CASMemoryBinaryStream::Write: stream is read only" );
+		m_bFailed = true;
+		return;
+	}
+
+	auto pBytes = reinterpret_cast<const char*>( pData );
+
+	m_WrittenData.insert( m_WrittenData.end(), pBytes, pBytes + uiSize );
+}
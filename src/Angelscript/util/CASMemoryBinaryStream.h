@@ -0,0 +1,64 @@
+#ifndef ANGELSCRIPT_UTIL_CASMEMORYBINARYSTREAM_H
+#define ANGELSCRIPT_UTIL_CASMEMORYBINARYSTREAM_H
+
+#include <cstddef>
+#include <vector>
+
+#include <angelscript.h>
+
+/**
+*	Binary stream that operates on memory.
+*	A stream constructed with a buffer reads from that buffer without copying it; the buffer must outlive the stream.
+*	A default constructed stream collects everything written to it.
+*/
+class CASMemoryBinaryStream final : public asIBinaryStream
+{
+public:
+	/**
+	*	Creates a stream that collects written data.
+	*/
+	CASMemoryBinaryStream() = default;
+
+	/**
+	*	Creates a stream that reads from the given buffer.
+	*	@param pData Data to read.
+	*	@param uiSize Size of the data, in bytes.
+	*/
+	CASMemoryBinaryStream( const void* pData, const size_t uiSize );
+
+	~CASMemoryBinaryStream() = default;
+
+	/**
+	*	@return Whether a read went past the end of the buffer, or data was written to a read only stream.
+	*/
+	bool HasFailed() const { return m_bFailed; }
+
+	/**
+	*	@return The number of bytes left to read.
+	*/
+	size_t GetRemainingBytes() const { return m_uiSize - m_uiPosition; }
+
+	/**
+	*	@return The data written to this stream.
+	*/
+	const std::vector<char>& GetWrittenData() const { return m_WrittenData; }
+
+	void Read( void* pData, asUINT uiSize ) override;
+
+	void Write( const void* pData, asUINT uiSize ) override;
+
+private:
+	const char* m_pData = nullptr;
+	size_t m_uiSize = 0;
+	size_t m_uiPosition = 0;
+
+	std::vector<char> m_WrittenData;
+
+	bool m_bFailed = false;
+
+private:
+	CASMemoryBinaryStream( const CASMemoryBinaryStream& ) = delete;
+	CASMemoryBinaryStream& operator=( const CASMemoryBinaryStream& ) = delete;
+};
+
+#endif //ANGELSCRIPT_UTIL_CASMEMORYBINARYSTREAM_H
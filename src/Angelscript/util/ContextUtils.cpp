@@ -70,6 +70,147 @@ bool SetArguments( const asIScriptFunction& targetFunc, asIScriptContext& contex
 	return bSuccess;
 }
 
+bool GetParamInfo( const asIScriptFunction& function, ParamList_t& params )
+{
+	const asUINT uiParamCount = function.GetParamCount();
+
+	params.resize( uiParamCount );
+
+	for( asUINT uiIndex = 0; uiIndex < uiParamCount; ++uiIndex )
+	{
+		auto& param = params[ uiIndex ];
+
+		if( function.GetParam( uiIndex, &param.iTypeId, &param.uiFlags ) < 0 )
+		{
+			as::Critical( "ctx::GetParamInfo: An error occurred while getting function parameter information, aborting!\n" );
+			params.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool DecodeArguments( DecodedArguments& arguments, const ParamList_t& params, va_list list )
+{
+	assert( list );
+
+	arguments.pParams = nullptr;
+
+	if( !list )
+		return false;
+
+	arguments.Values.resize( params.size() );
+
+	VAList vaList;
+
+	//GCC fails to copy the list if it's done any other way.
+	va_copy( vaList.list, list );
+
+	bool bSuccess = true;
+
+	for( size_t uiIndex = 0; uiIndex < params.size() && bSuccess; ++uiIndex )
+	{
+		bSuccess = GetArgumentFromVarargs( arguments.Values[ uiIndex ], params[ uiIndex ].iTypeId, params[ uiIndex ].uiFlags, vaList );
+	}
+
+	va_end( vaList.list );
+
+	if( bSuccess )
+		arguments.pParams = &params;
+
+	return bSuccess;
+}
+
+bool DecodeArguments( DecodedArguments& arguments, const ParamList_t& params, const CASArguments& args )
+{
+	arguments.pParams = nullptr;
+
+	if( args.GetArgumentCount() != params.size() )
+	{
+		as::Critical( "ctx::DecodeArguments: argument count is incorrect: expected %u, got %u!\n",
+			static_cast<unsigned int>( params.size() ), static_cast<unsigned int>( args.GetArgumentCount() ) );
+		return false;
+	}
+
+	arguments.Values.resize( params.size() );
+
+	const auto& argList = args.GetArgumentList();
+
+	for( size_t uiIndex = 0; uiIndex < params.size(); ++uiIndex )
+	{
+		const auto& arg = argList[ uiIndex ];
+
+		if( arg.GetTypeId() != params[ uiIndex ].iTypeId )
+		{
+			as::Critical( "ctx::DecodeArguments: argument %u has the wrong type!\n", static_cast<unsigned int>( uiIndex ) );
+			return false;
+		}
+
+		//Primitives and enums passed by reference refer to the stored value.
+		if( !( arg.GetTypeId() & ( asTYPEID_OBJHANDLE | asTYPEID_MASK_OBJECT ) ) && ( params[ uiIndex ].uiFlags & ( asTM_INREF | asTM_OUTREF ) ) )
+			arguments.Values[ uiIndex ].pValue = arg.GetArgumentAsPointer();
+		else
+			arguments.Values[ uiIndex ] = arg.GetArgumentValue();
+	}
+
+	arguments.pParams = &params;
+
+	return true;
+}
+
+bool SetArguments( const asIScriptFunction& targetFunc, asIScriptContext& context, const DecodedArguments& arguments )
+{
+	if( !arguments.pParams || arguments.pParams->size() != targetFunc.GetParamCount() )
+	{
+		as::Critical( "ctx::SetArguments: decoded arguments do not match function '%s::%s'!\n", targetFunc.GetNamespace(), targetFunc.GetName() );
+		return false;
+	}
+
+	const auto& params = *arguments.pParams;
+
+	for( asUINT uiIndex = 0; uiIndex < params.size(); ++uiIndex )
+	{
+		const auto iTypeId = params[ uiIndex ].iTypeId;
+		const auto& value = arguments.Values[ uiIndex ];
+
+		int iResult;
+
+		//Objects and handles are passed by address, as are primitives and enums taken by reference.
+		if( ( iTypeId & ( asTYPEID_OBJHANDLE | asTYPEID_MASK_OBJECT ) ) )
+		{
+			iResult = context.SetArgObject( uiIndex, value.pValue );
+		}
+		else if( params[ uiIndex ].uiFlags & ( asTM_INREF | asTM_OUTREF ) )
+		{
+			iResult = context.SetArgAddress( uiIndex, value.pValue );
+		}
+		else
+		{
+			switch( iTypeId )
+			{
+			case asTYPEID_BOOL:
+			case asTYPEID_INT8:
+			case asTYPEID_UINT8:	iResult = context.SetArgByte( uiIndex, value.byte ); break;
+			case asTYPEID_INT16:
+			case asTYPEID_UINT16:	iResult = context.SetArgWord( uiIndex, value.word ); break;
+			case asTYPEID_INT64:
+			case asTYPEID_UINT64:	iResult = context.SetArgQWord( uiIndex, value.qword ); break;
+			case asTYPEID_FLOAT:	iResult = context.SetArgFloat( uiIndex, value.flValue ); break;
+			case asTYPEID_DOUBLE:	iResult = context.SetArgDouble( uiIndex, value.dValue ); break;
+
+			//32 bit integers and enums.
+			default:				iResult = context.SetArgDWord( uiIndex, value.dword ); break;
+			}
+		}
+
+		if( iResult < 0 )
+			return false;
+	}
+
+	return true;
+}
+
 bool SetArgument( asIScriptEngine& engine, void* pData, int iTypeId, CASArgument& arg )
 {
 	bool bSuccess = true;
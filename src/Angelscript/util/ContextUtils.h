@@ -1,6 +1,8 @@
 #ifndef UTIL_CONTEXTUTILS_H
 #define UTIL_CONTEXTUTILS_H
 
+#include <vector>
+
 #include <angelscript.h>
 
 #include "Angelscript/wrapper/CASArguments.h"
@@ -21,6 +23,58 @@ struct VAList final
 	va_list list;
 };
 
+/**
+*	Type information for a single parameter.
+*/
+struct ParamInfo final
+{
+	int iTypeId;
+	asDWORD uiFlags;
+};
+
+typedef std::vector<ParamInfo> ParamList_t;
+
+/**
+*	Arguments decoded from varargs, that can be set on any number of calls to functions that take the same parameters.
+*	The values are stored the same way that SetContextArgument expects varargs values.
+*/
+struct DecodedArguments final
+{
+	/**
+	*	Parameters the arguments were decoded for.
+	*/
+	const ParamList_t* pParams = nullptr;
+
+	std::vector<ArgumentValue> Values;
+};
+
+/**
+*	Gets the type information for every parameter of a function.
+*	@param function Function.
+*	@param[ out ] params Parameter list.
+*	@return true on success, false otherwise.
+*/
+bool GetParamInfo( const asIScriptFunction& function, ParamList_t& params );
+
+/**
+*	Decodes arguments from varargs. Existing storage in arguments is reused.
+*	@param arguments Arguments to decode into.
+*	@param params Parameters to decode. Must outlive the arguments.
+*	@param list Pointer to the arguments.
+*	@return true on success, false otherwise.
+*/
+bool DecodeArguments( DecodedArguments& arguments, const ParamList_t& params, va_list list );
+
+/**
+*	Decodes arguments from stored arguments. Existing storage in arguments is reused.
+*	The decoded arguments point into args, so args must outlive them.
+*	@param arguments Arguments to decode into.
+*	@param params Parameters to decode. Must outlive the arguments.
+*	@param args Stored arguments. Must match the parameters exactly.
+*	@return true on success, false otherwise.
+*/
+bool DecodeArguments( DecodedArguments& arguments, const ParamList_t& params, const CASArguments& args );
+
 /**
 *	Sets arguments for a function call.
 *	@param targetFunc Target function.
@@ -39,6 +93,16 @@ bool SetArguments( const asIScriptFunction& targetFunc, asIScriptContext& contex
 */
 bool SetArguments( const asIScriptFunction& targetFunc, asIScriptContext& context, va_list list );
 
+/**
+*	Sets arguments for a function call. The function must take the parameters the arguments were decoded for.
+*	Since the types are known to match, no conversions are performed.
+*	@param targetFunc Target function.
+*	@param context Context.
+*	@param arguments Decoded arguments.
+*	@return true on success, false otherwise.
+*/
+bool SetArguments( const asIScriptFunction& targetFunc, asIScriptContext& context, const DecodedArguments& arguments );
+
 /**
 *	Sets an argument on arg. Determines whether it's a primitive or object argument.
 *	@param engine Script engine.
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <cstring>
 #include <functional>
 #include <string>
@@ -37,6 +38,43 @@ inline size_t StringHash( const char* const pszString )
 	return ( _Val );
 }
 
+/**
+*	FNV-1a offset basis for Hash64.
+*/
+const uint64_t FNV1A64_OFFSET_BASIS = 14695981039346656037ULL;
+
+/**
+*	64 bit FNV-1a hash of a block of memory.
+*	Unlike StringHash, the result does not depend on the size of size_t, so it can be used for keys that are persisted to disk.
+*	@param pData Data to hash.
+*	@param uiSize Size of the data, in bytes.
+*	@param uiHash Hash to continue from. Allows multiple blocks of memory to be hashed together.
+*	@return Hash.
+*/
+inline uint64_t Hash64( const void* const pData, const size_t uiSize, uint64_t uiHash = FNV1A64_OFFSET_BASIS )
+{
+	const uint64_t FNV_prime = 1099511628211ULL;
+
+	auto pBytes = reinterpret_cast<const unsigned char*>( pData );
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		uiHash ^= pBytes[ uiIndex ];
+		uiHash *= FNV_prime;
+	}
+
+	return uiHash;
+}
+
+/**
+*	Hashes a null terminated string, including the terminator so that consecutive strings produce distinct hashes.
+*	@see Hash64( const void* const pData, const size_t uiSize, uint64_t uiHash )
+*/
+inline uint64_t Hash64( const char* const pszString, uint64_t uiHash = FNV1A64_OFFSET_BASIS )
+{
+	return Hash64( pszString, strlen( pszString ) + 1, uiHash );
+}
+
 template<typename STR>
 struct Hash_C_String final : public std::unary_function<STR*, size_t>
 {
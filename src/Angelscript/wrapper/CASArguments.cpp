@@ -205,6 +205,11 @@ void CASArguments::Clear()
 	m_Arguments.shrink_to_fit();
 }
 
+void CASArguments::Reset()
+{
+	m_Arguments.clear();
+}
+
 const CASArgument* CASArguments::GetArgument( const size_t uiIndex ) const
 {
 	assert( uiIndex < m_Arguments.size() );
@@ -230,7 +235,14 @@ bool CASArguments::SetArguments( asIScriptGeneric& arguments, size_t uiStartInde
 
 	bool bSuccess = true;
 
-	Arguments_t args( uiTargetArgs );
+	//If there are no arguments to preserve on failure, decode into our own storage so it can be reused.
+	const bool bInPlace = m_Arguments.empty();
+
+	Arguments_t tempArgs;
+
+	Arguments_t& args = bInPlace ? m_Arguments : tempArgs;
+
+	args.resize( uiTargetArgs );
 
 	auto pEngine = CASManager::GetActiveManager()->GetEngine();
 
@@ -242,7 +254,12 @@ bool CASArguments::SetArguments( asIScriptGeneric& arguments, size_t uiStartInde
 		bSuccess = ctx::SetArgument( *pEngine, pData, iTypeId, args[ uiIndex ] );
 	}
 
-	if( bSuccess )
+	if( bInPlace )
+	{
+		if( !bSuccess )
+			m_Arguments.clear();
+	}
+	else if( bSuccess )
 	{
 		m_Arguments = std::move( args );
 	}
@@ -256,11 +273,12 @@ bool CASArguments::SetArguments( asIScriptFunction& targetFunc, va_list list )
 	if( !list )
 		return false;
 
-	Clear();
+	//Decode into our own storage so it can be reused. Existing arguments are discarded even if this fails.
+	Reset();
 
 	const asUINT uiArgCount = targetFunc.GetParamCount();
 
-	Arguments_t args( uiArgCount );
+	m_Arguments.resize( uiArgCount );
 
 	bool bSuccess = true;
 
@@ -285,15 +303,16 @@ bool CASArguments::SetArguments( asIScriptFunction& targetFunc, va_list list )
 			break;
 		}
 
+		//Primitives and enums have no object flags.
 		asITypeInfo* pType = pEngine->GetTypeInfoById( iTypeId );
 
-		asDWORD uiObjFlags = pType->GetFlags();
+		asDWORD uiObjFlags = pType ? pType->GetFlags() : 0;
 		ArgType::ArgType argType;
 
 		if( ( bSuccess = ctx::GetArgumentFromVarargs( value, iTypeId, uiFlags, vaList, &uiObjFlags, &argType ) ) != false )
 		{
 			//Make copies of the input arguments; they won't exist anymore once this method has finished execution.
-			args[ uiIndex ].Set( *pEngine, iTypeId, argType, value, true );
+			m_Arguments[ uiIndex ].Set( *pEngine, iTypeId, argType, value, true );
 		}
 		else
 		{
@@ -310,10 +329,8 @@ bool CASArguments::SetArguments( asIScriptFunction& targetFunc, va_list list )
 		}
 	}
 
-	if( bSuccess )
-	{
-		m_Arguments = std::move( args );
-	}
+	if( !bSuccess )
+		Reset();
 
 	return bSuccess;
 }
\ No newline at end of file
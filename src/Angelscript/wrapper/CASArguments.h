@@ -228,6 +228,11 @@ public:
 	*/
 	void Clear();
 
+	/**
+	*	Clears the list of arguments, but keeps the storage so setting arguments again doesn't allocate it.
+	*/
+	void Reset();
+
 	/**
 	*	@return The list of arguments.
 	*/
@@ -251,6 +256,7 @@ public:
 
 	/**
 	*	Sets the list of arguments to that of the given generic call instance.
+	*	If the list is empty, its storage is reused.
 	*	@param arguments Generic call instance.
 	*	@param uiStartIndex The index of the first argument to use.
 	*	@return true on success, false otherwise.
@@ -0,0 +1,85 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <angelscript.h>
+
+#include "Angelscript/CASManager.h"
+#include "Angelscript/CASModule.h"
+#include "Angelscript/CASModuleBundle.h"
+#include "Angelscript/CASModuleManager.h"
+
+#include "Angelscript/util/ASExtendAdapter.h"
+#include "Angelscript/util/ASLogging.h"
+
+#include "CASTestInitializer.h"
+
+/*
+*	Offline compiler that builds scripts into a module bundle.
+*	Uses the same initializer and module builder as the test program, so the bundle matches the API it will be loaded with.
+*	Usage: AngelscriptUtilsBundleCompiler <output file> <descriptor> <module name> <script file> [<descriptor> <module name> <script file> ...]
+*/
+int main( int iArgc, char* pszArgV[] )
+{
+	if( iArgc < 5 || ( iArgc - 2 ) % 3 != 0 )
+	{
+		std::cerr << "Usage: " << pszArgV[ 0 ] << " <output file> <descriptor> <module name> <script file> [<descriptor> <module name> <script file> ...]" << std::endl;
+		return 1;
+	}
+
+	const char* const pszOutputFile = pszArgV[ 1 ];
+
+	CASManager manager;
+
+	CASTestInitializer initializer( manager );
+
+	if( !manager.Initialize( initializer ) )
+	{
+		std::cerr << "Could not initialize the script engine" << std::endl;
+		return 1;
+	}
+
+	AddTestDescriptors( manager.GetModuleManager() );
+
+	const auto szDecl = as::CreateExtendBaseclassDeclaration( "CScriptBaseEntity", "IScriptEntity", "CBaseEntity", "BaseEntity" );
+
+	CASModuleBundleWriter writer( *manager.GetEngine() );
+
+	int iResult = 0;
+
+	for( int iArg = 2; iArg < iArgc; iArg += 3 )
+	{
+		const char* const pszDescriptor = pszArgV[ iArg ];
+		const char* const pszModuleName = pszArgV[ iArg + 1 ];
+		const char* const pszScriptFile = pszArgV[ iArg + 2 ];
+
+		CASTestModuleBuilder builder( szDecl, pszScriptFile );
+
+		auto pModule = manager.GetModuleManager().BuildModule( pszDescriptor, pszModuleName, builder );
+
+		if( !pModule || !writer.AddModule( *pModule ) )
+		{
+			std::cerr << "Could not compile module \"" << pszModuleName << "\" from \"" << pszScriptFile << "\"" << std::endl;
+			iResult = 1;
+			break;
+		}
+
+		std::cout << "Compiled module \"" << pszModuleName << "\"" << std::endl;
+	}
+
+	if( iResult == 0 )
+	{
+		if( writer.Write( pszOutputFile ) )
+		{
+			std::cout << "Wrote " << writer.GetModuleCount() << " module(s) to \"" << pszOutputFile << "\"" << std::endl;
+		}
+		else
+		{
+			iResult = 1;
+		}
+	}
+
+	manager.Shutdown();
+
+	return iResult;
+}
@@ -0,0 +1,49 @@
+#include <iostream>
+
+#include "Angelscript/CASLoggingContextResultHandler.h"
+#include "Angelscript/CASModuleManager.h"
+
+#include "CASTestInitializer.h"
+
+void Print( const std::string& szString )
+{
+	std::cout << szString;
+}
+
+int NSTest()
+{
+	return 0;
+}
+
+asIScriptContext* CreateScriptContext( asIScriptEngine* pEngine, void* )
+{
+	auto pContext = pEngine->CreateContext();
+
+	//TODO: add test to see if suspending will log an error.
+	auto pResultHandler = new CASLoggingContextResultHandler( CASLoggingContextResultHandler::Flag::SUSPEND_IS_ERROR );
+
+	as::SetContextResultHandler( *pContext, pResultHandler );
+
+	pResultHandler->Release();
+
+	return pContext;
+}
+
+void DestroyScriptContext( asIScriptEngine* ASUNREFERENCED( pEngine ), asIScriptContext* pContext, void* )
+{
+	if( pContext )
+		pContext->Release();
+}
+
+CASEvent testEvent( "Main", "const " AS_STRING_OBJNAME "& in", "", ModuleAccessMask::ALL, EventStopMode::ON_HANDLED );
+
+CASTypedEvent<const std::string&, int> typedTestEvent( "Typed", "const " AS_STRING_OBJNAME "& in, int", "", ModuleAccessMask::ALL, EventStopMode::ON_HANDLED );
+
+void AddTestDescriptors( CASModuleManager& moduleManager )
+{
+	//Map scripts are per-map scripts that always have their hooks executed before any other module.
+	moduleManager.AddDescriptor( "MapScript", ModuleAccessMask::MAPSCRIPT, as::ModulePriority::HIGHEST );
+
+	//Plugins are persistent scripts that can keep running after map changes.
+	moduleManager.AddDescriptor( "Plugin", ModuleAccessMask::PLUGIN );
+}
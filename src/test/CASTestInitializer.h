@@ -0,0 +1,222 @@
+#ifndef TEST_CASTESTINITIALIZER_H
+#define TEST_CASTESTINITIALIZER_H
+
+#include <string>
+
+#include <angelscript.h>
+
+#include "Angelscript/CASManager.h"
+#include "Angelscript/CASModule.h"
+#include "Angelscript/IASInitializer.h"
+#include "Angelscript/IASModuleBuilder.h"
+
+#include "Angelscript/add_on/scriptbuilder.h"
+#include "Angelscript/add_on/scriptstdstring.h"
+#include "Angelscript/add_on/scriptarray.h"
+#include "Angelscript/add_on/scriptdictionary.h"
+#include "Angelscript/add_on/scriptany.h"
+
+#include "Angelscript/event/CASEvent.h"
+#include "Angelscript/event/CASEventManager.h"
+#include "Angelscript/event/CASTypedEvent.h"
+
+#include "Angelscript/ScriptAPI/CASScheduler.h"
+#include "Angelscript/ScriptAPI/Reflection/ASReflection.h"
+
+#include "Angelscript/util/ASUtil.h"
+
+#include "ASCBaseEntity.h"
+
+/*
+*	API shared by the test program and the bundle compiler, so bundles are compiled against the same API they're loaded with.
+*/
+
+namespace ModuleAccessMask
+{
+/**
+*	Access masks for modules.
+*/
+enum ModuleAccessMask
+{
+	/**
+	*	No access.
+	*/
+	NONE			= 0,
+
+	/**
+	*	Shared API.
+	*/
+	SHARED			= 1 << 0,
+
+	/**
+	*	Map script specific.
+	*/
+	MAPSCRIPT_ONLY	= 1 << 1,
+
+	MAPSCRIPT		= SHARED | MAPSCRIPT_ONLY,
+
+	/**
+	*	Plugin script specific.
+	*/
+	PLUGIN_ONLY		= 1 << 2,
+
+	PLUGIN			= SHARED | PLUGIN_ONLY,
+
+	/**
+	*	All scripts.
+	*/
+	ALL			= SHARED | MAPSCRIPT | PLUGIN
+};
+}
+
+void Print( const std::string& szString );
+
+int NSTest();
+
+asIScriptContext* CreateScriptContext( asIScriptEngine* pEngine, void* );
+
+void DestroyScriptContext( asIScriptEngine* ASUNREFERENCED( pEngine ), asIScriptContext* pContext, void* );
+
+const bool USE_EVENT_MANAGER = true;
+
+/*
+*	An event to test out the event system.
+*	Stops as soon as it's handled.
+*	Can be hooked by calling Events::Main.Hook( @MainHook( ... ) );
+*/
+extern CASEvent testEvent;
+
+/**
+*	An event whose argument types are checked at compile time.
+*	Can be hooked by calling Events::Typed.Hook( @TypedHook( ... ) );
+*/
+extern CASTypedEvent<const std::string&, int> typedTestEvent;
+
+/**
+*	Adds the module descriptors used by the test program.
+*/
+void AddTestDescriptors( CASModuleManager& moduleManager );
+
+class CASTestInitializer : public IASInitializer
+{
+public:
+	CASTestInitializer( CASManager& manager )
+		: m_Manager( manager )
+	{
+	}
+
+	bool UseEventManager() override { return USE_EVENT_MANAGER; }
+
+	void OnInitBegin()
+	{
+		m_Manager.GetEngine()->SetContextCallbacks( &::CreateScriptContext, &::DestroyScriptContext );
+	}
+
+	bool RegisterCoreAPI( CASManager& manager ) override
+	{
+		RegisterStdString( manager.GetEngine() );
+		RegisterScriptArray( manager.GetEngine(), true );
+		RegisterScriptDictionary( manager.GetEngine() );
+		RegisterScriptAny( manager.GetEngine() );
+		RegisterScriptScheduler( manager.GetEngine() );
+		RegisterScriptReflection( *manager.GetEngine() );
+
+		RegisterScriptEventAPI( *manager.GetEngine() );
+
+		manager.GetEngine()->RegisterTypedef( "size_t", "uint32" );
+
+		return true;
+	}
+
+	bool AddEvents( CASManager& ASUNREFERENCED( manager ), CASEventManager& eventManager ) override
+	{
+		//Add an event. Scripts will be able to hook these, when it's invoked by C++ code all hooked functions are called.
+		eventManager.AddEvent( &testEvent );
+		eventManager.AddEvent( &typedTestEvent );
+
+		return true;
+	}
+
+	bool RegisterAPI( CASManager& manager ) override
+	{
+		auto pEngine = manager.GetEngine();
+
+		//Printing function.
+		pEngine->RegisterGlobalFunction( "void Print(const " AS_STRING_OBJNAME "& in szString)", asFUNCTION( Print ), asCALL_CDECL );
+
+		pEngine->SetDefaultNamespace( "NS" );
+
+		pEngine->RegisterGlobalFunction( 
+			"int NSTest()", 
+			asFUNCTION( NSTest ),
+			asCALL_CDECL );
+
+		pEngine->SetDefaultNamespace( "" );
+
+		//Register the interface that all custom entities use. Allows you to take them as handles to functions.
+		pEngine->RegisterInterface( "IScriptEntity" );
+
+		//Register the entity class.
+		RegisterScriptCBaseEntity( *pEngine );
+
+		//Register the entity base class. Used to call base class implementations.
+		RegisterScriptBaseEntity( *pEngine );
+
+		return true;
+	}
+
+private:
+	CASManager& m_Manager;
+};
+
+/**
+*	Builder for the test script.
+*/
+class CASTestModuleBuilder : public IASModuleBuilder
+{
+public:
+	CASTestModuleBuilder( const std::string& szDecl, const char* const pszScriptFile = "scripts/test.as" )
+		: m_szDecl( szDecl )
+		, m_szScriptFile( pszScriptFile )
+	{
+	}
+
+	bool AddScripts( CScriptBuilder& builder ) override
+	{
+		//By using a handle this can be changed, but since there are no other instances, it can only be made null.
+		//TODO: figure out a better way.
+		auto result = builder.AddSectionFromMemory( 
+			"__Globals", 
+			"CScheduler@ Scheduler;" );
+
+		if( result < 0 )
+			return false;
+
+		if( builder.AddSectionFromMemory(
+			"__CScriptBaseEntity",
+			m_szDecl.c_str() ) < 0 )
+			return false;
+
+		return builder.AddSectionFromFile( m_szScriptFile.c_str() ) >= 0;
+	}
+
+	bool PostBuild( CScriptBuilder& ASUNREFERENCED( builder ), const bool bSuccess, CASModule* pModule ) override
+	{
+		if( !bSuccess )
+			return false;
+
+		auto& scriptModule = *pModule->GetModule();
+
+		//Set the scheduler instance.
+		if( !as::SetGlobalByName( scriptModule, "Scheduler", pModule->GetScheduler() ) )
+			return false;
+
+		return true;
+	}
+
+private:
+	std::string m_szDecl;
+	std::string m_szScriptFile;
+};
+
+#endif //TEST_CASTESTINITIALIZER_H
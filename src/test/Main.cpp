@@ -1,8 +1,13 @@
+#include <cstring>
 #include <iostream>
 
 #include <angelscript.h>
 
+#include "Angelscript/CASAsyncModuleBuild.h"
+#include "Angelscript/CASBytecodeCache.h"
 #include "Angelscript/CASManager.h"
+#include "Angelscript/CASModuleBundle.h"
+#include "Angelscript/CASModuleMemory.h"
 #include "Angelscript/event/CASEvent.h"
 #include "Angelscript/event/CASEventCaller.h"
 #include "Angelscript/CASModule.h"
@@ -34,202 +39,7 @@
 #include "CBaseEntity.h"
 #include "CScriptBaseEntity.h"
 #include "ASCBaseEntity.h"
-
-namespace ModuleAccessMask
-{
-/**
-*	Access masks for modules.
-*/
-enum ModuleAccessMask
-{
-	/**
-	*	No access.
-	*/
-	NONE			= 0,
-
-	/**
-	*	Shared API.
-	*/
-	SHARED			= 1 << 0,
-
-	/**
-	*	Map script specific.
-	*/
-	MAPSCRIPT_ONLY	= 1 << 1,
-
-	MAPSCRIPT		= SHARED | MAPSCRIPT_ONLY,
-
-	/**
-	*	Plugin script specific.
-	*/
-	PLUGIN_ONLY		= 1 << 2,
-
-	PLUGIN			= SHARED | PLUGIN_ONLY,
-
-	/**
-	*	All scripts.
-	*/
-	ALL			= SHARED | MAPSCRIPT | PLUGIN
-};
-}
-
-void Print( const std::string& szString )
-{
-	std::cout << szString;
-}
-
-int NSTest()
-{
-	return 0;
-}
-
-asIScriptContext* CreateScriptContext( asIScriptEngine* pEngine, void* )
-{
-	auto pContext = pEngine->CreateContext();
-
-	//TODO: add test to see if suspending will log an error.
-	auto pResultHandler = new CASLoggingContextResultHandler( CASLoggingContextResultHandler::Flag::SUSPEND_IS_ERROR );
-
-	as::SetContextResultHandler( *pContext, pResultHandler );
-
-	pResultHandler->Release();
-
-	return pContext;
-}
-
-void DestroyScriptContext( asIScriptEngine* ASUNREFERENCED( pEngine ), asIScriptContext* pContext, void* )
-{
-	if( pContext )
-		pContext->Release();
-}
-
-const bool USE_EVENT_MANAGER = true;
-
-/*
-*	An event to test out the event system.
-*	Stops as soon as it's handled.
-*	Can be hooked by calling Events::Main.Hook( @MainHook( ... ) );
-*/
-CASEvent testEvent( "Main", "const " AS_STRING_OBJNAME "& in", "", ModuleAccessMask::ALL, EventStopMode::ON_HANDLED );
-
-class CASTestInitializer : public IASInitializer
-{
-public:
-	CASTestInitializer( CASManager& manager )
-		: m_Manager( manager )
-	{
-	}
-
-	bool UseEventManager() override { return USE_EVENT_MANAGER; }
-
-	void OnInitBegin()
-	{
-		m_Manager.GetEngine()->SetContextCallbacks( &::CreateScriptContext, &::DestroyScriptContext );
-	}
-
-	bool RegisterCoreAPI( CASManager& manager ) override
-	{
-		RegisterStdString( manager.GetEngine() );
-		RegisterScriptArray( manager.GetEngine(), true );
-		RegisterScriptDictionary( manager.GetEngine() );
-		RegisterScriptAny( manager.GetEngine() );
-		RegisterScriptScheduler( manager.GetEngine() );
-		RegisterScriptReflection( *manager.GetEngine() );
-
-		RegisterScriptEventAPI( *manager.GetEngine() );
-
-		manager.GetEngine()->RegisterTypedef( "size_t", "uint32" );
-
-		return true;
-	}
-
-	bool AddEvents( CASManager& ASUNREFERENCED( manager ), CASEventManager& eventManager ) override
-	{
-		//Add an event. Scripts will be able to hook these, when it's invoked by C++ code all hooked functions are called.
-		eventManager.AddEvent( &testEvent );
-
-		return true;
-	}
-
-	bool RegisterAPI( CASManager& manager ) override
-	{
-		auto pEngine = manager.GetEngine();
-
-		//Printing function.
-		pEngine->RegisterGlobalFunction( "void Print(const " AS_STRING_OBJNAME "& in szString)", asFUNCTION( Print ), asCALL_CDECL );
-
-		pEngine->SetDefaultNamespace( "NS" );
-
-		pEngine->RegisterGlobalFunction( 
-			"int NSTest()", 
-			asFUNCTION( NSTest ),
-			asCALL_CDECL );
-
-		pEngine->SetDefaultNamespace( "" );
-
-		//Register the interface that all custom entities use. Allows you to take them as handles to functions.
-		pEngine->RegisterInterface( "IScriptEntity" );
-
-		//Register the entity class.
-		RegisterScriptCBaseEntity( *pEngine );
-
-		//Register the entity base class. Used to call base class implementations.
-		RegisterScriptBaseEntity( *pEngine );
-
-		return true;
-	}
-
-private:
-	CASManager& m_Manager;
-};
-
-/**
-*	Builder for the test script.
-*/
-class CASTestModuleBuilder : public IASModuleBuilder
-{
-public:
-	CASTestModuleBuilder( const std::string& szDecl )
-		: m_szDecl( szDecl )
-	{
-	}
-
-	bool AddScripts( CScriptBuilder& builder ) override
-	{
-		//By using a handle this can be changed, but since there are no other instances, it can only be made null.
-		//TODO: figure out a better way.
-		auto result = builder.AddSectionFromMemory( 
-			"__Globals", 
-			"CScheduler@ Scheduler;" );
-
-		if( result < 0 )
-			return false;
-
-		if( builder.AddSectionFromMemory(
-			"__CScriptBaseEntity",
-			m_szDecl.c_str() ) < 0 )
-			return false;
-
-		return builder.AddSectionFromFile( "scripts/test.as" ) >= 0;
-	}
-
-	bool PostBuild( CScriptBuilder& ASUNREFERENCED( builder ), const bool bSuccess, CASModule* pModule ) override
-	{
-		if( !bSuccess )
-			return false;
-
-		auto& scriptModule = *pModule->GetModule();
-
-		//Set the scheduler instance.
-		if( !as::SetGlobalByName( scriptModule, "Scheduler", pModule->GetScheduler() ) )
-			return false;
-
-		return true;
-	}
-
-private:
-	std::string m_szDecl;
-};
+#include "CASTestInitializer.h"
 
 class CASModuleUserData : public IASModuleUserData
 {
@@ -273,7 +83,11 @@ public:
 
 	void VLog( LogLevel_t logLevel, const char* pszFormat, va_list list ) override
 	{
-		m_FileLogger.VLog( logLevel, pszFormat, list );
+		//The list can only be used once, so the file logger gets a copy.
+		va_list fileList;
+		va_copy( fileList, list );
+		m_FileLogger.VLog( logLevel, pszFormat, fileList );
+		va_end( fileList );
 
 		char szBuffer[ 4096 ];
 
@@ -300,6 +114,9 @@ int main( int ASUNREFERENCED( iArgc ), char* ASUNREFERENCED( pszArgV )[] )
 	//Needed so the test script can load.
 	chdir( ".." );
 
+	//Must be installed before the engine is created.
+	as::InstallMemoryTracking();
+
 	CASManager manager;
 
 	CASTestInitializer initializer( manager );
@@ -314,12 +131,7 @@ int main( int ASUNREFERENCED( iArgc ), char* ASUNREFERENCED( pszArgV )[] )
 		std::cout << szDecl << std::endl;
 
 		//Create some module types.
-
-		//Map scripts are per-map scripts that always have their hooks executed before any other module.
-		manager.GetModuleManager().AddDescriptor( "MapScript", ModuleAccessMask::MAPSCRIPT, as::ModulePriority::HIGHEST );
-
-		//Plugins are persistent scripts that can keep running after map changes.
-		manager.GetModuleManager().AddDescriptor( "Plugin", ModuleAccessMask::PLUGIN );
+		AddTestDescriptors( manager.GetModuleManager() );
 
 		//Make a map script.
 		CASTestModuleBuilder builder( szDecl );
@@ -345,9 +157,64 @@ int main( int ASUNREFERENCED( iArgc ), char* ASUNREFERENCED( pszArgV )[] )
 					CASEventCaller caller;
 
 					caller.Call( testEvent, pEngine, &szString, true );
+
+					//Typed events pass their arguments directly.
+					typedTestEvent.Trigger( pEngine, "typed", 42 );
+
+					//main doesn't match the typed event's parameters, so it is rejected here instead of when the event is triggered.
+					const bool bAdded = typedTestEvent.AddFunction( pFunction );
+
+					std::cout << "Mismatched hook rejected: " << ( !bAdded ? "yes" : "no" ) << std::endl;
+
+					//Posted events are triggered by Flush. The arguments are copied, so they don't have to outlive the post.
+					auto& eventManager = *manager.GetEventManager();
+
+					{
+						std::string szFirst = "posted", szSecond = "replaced", szThird = "coalesced";
+
+						eventManager.Post( &typedTestEvent, &szFirst, 1 );
+
+						//Only the last coalesced post's arguments are used.
+						eventManager.PostCoalesced( &typedTestEvent, &szSecond, 2 );
+						eventManager.PostCoalesced( &typedTestEvent, &szThird, 3 );
+					}
+
+					std::cout << "Queued events: " << eventManager.GetQueuedEventCount() << std::endl;
+
+					const size_t uiFlushed = eventManager.Flush();
+
+					std::cout << "Flushed events: " << uiFlushed << std::endl;
+
+					//Filtered hooks are only invoked by triggers that pass their object's key.
+					auto pScriptModule = pModule->GetModule();
+
+					if( auto ppFilterTarget = reinterpret_cast<void**>( pScriptModule->GetAddressOfGlobalVar( pScriptModule->GetGlobalVarIndexByName( "g_pFilterTarget" ) ) ) )
+					{
+						typedTestEvent.TriggerFiltered( pEngine, CASBaseEvent::GetObjectFilterKey( *ppFilterTarget ), "filtered", 4 );
+						typedTestEvent.TriggerFiltered( pEngine, 1, "key 1", 5 );
+						typedTestEvent.TriggerFiltered( pEngine, 2, "key 2", 6 );
+						typedTestEvent.TriggerFiltered( pEngine, 3, "unfiltered", 7 );
+					}
+
+					if( auto pReleaseFunction = pScriptModule->GetFunctionByName( "ReleaseFilterTarget" ) )
+						as::Call( pReleaseFunction );
+
+					//Removing a function removes it for every key. This releases the filter target.
+					if( auto pFilteredFunction = pScriptModule->GetFunctionByName( "FilteredTypedFunc" ) )
+					{
+						typedTestEvent.RemoveFunction( pFilteredFunction );
+
+						typedTestEvent.TriggerFiltered( pEngine, 1, "removed", 8 );
+					}
 				}
 			}
 
+			//Memory is attributed to every module, quotas are optional.
+			for( const auto& entry : manager.GetModuleManager().GetMemoryReport() )
+			{
+				std::cout << "Module \"" << entry.szModuleName << "\" has live memory: " << ( entry.uiLiveBytes > 0 ? "yes" : "no" ) << ", quota: " << entry.uiQuota << std::endl;
+			}
+
 			//Test the object pointer.
 			if( auto pFunction = pModule->GetModule()->GetFunctionByName( "GetLifetime" ) )
 			{
@@ -452,6 +319,35 @@ int main( int ASUNREFERENCED( iArgc ), char* ASUNREFERENCED( pszArgV )[] )
 			//Test the scheduler.
 			pModule->GetScheduler()->Think( 10 );
 
+			//Function handles and delegates are scheduled without looking them up by name.
+			if( auto pFunction = pModule->GetModule()->GetFunctionByName( "ScheduleHandles" ) )
+			{
+				as::Call( pFunction );
+
+				pModule->GetScheduler()->Think( 12 );
+			}
+
+			if( auto pFunction = pModule->GetModule()->GetFunctionByName( "StopTimer" ) )
+			{
+				as::Call( pFunction );
+
+				pModule->GetScheduler()->Think( 14 );
+			}
+
+			//Budgeted thinks always call the most overdue function, and leave the rest for the next think.
+			if( auto pFunction = pModule->GetModule()->GetFunctionByName( "ScheduleBudgeted" ) )
+			{
+				as::Call( pFunction );
+
+				auto result = pModule->GetScheduler()->ThinkBudgeted( 20, 0 );
+
+				std::cout << "Budgeted think called " << result.uiCalled << ", deferred " << result.uiDeferred << std::endl;
+
+				result = pModule->GetScheduler()->ThinkBudgeted( 20, 1000000 );
+
+				std::cout << "Budgeted think called " << result.uiCalled << ", deferred " << result.uiDeferred << std::endl;
+			}
+
 			//Get the parameter types. Angelscript's type info support isn't complete yet, so not all types have an asITypeInfo instance yet.
 			/*
 			if( auto pFunc2 = pModule->GetModule()->GetFunctionByName( "Function" ) )
@@ -518,8 +414,74 @@ int main( int ASUNREFERENCED( iArgc ), char* ASUNREFERENCED( pszArgV )[] )
 
 			manager.GetEventManager()->DumpHookedFunctions();
 
+			//Save the module so it can be loaded from a bundle below.
+			CASModuleBundleWriter bundleWriter( *pEngine );
+
+			const bool bWroteBundle = bundleWriter.AddModule( *pModule ) && bundleWriter.Write( "logs/MapModule.bundle" );
+
 			//Remove the module.
 			manager.GetModuleManager().RemoveModule( pModule );
+
+			//Build modules in the background. Bundles can be loaded while a build is compiling.
+			auto& moduleManager = manager.GetModuleManager();
+
+			if( bWroteBundle )
+			{
+				auto pDescriptor = moduleManager.FindDescriptorByName( "MapScript" );
+
+				auto build = moduleManager.BuildModuleAsync( *pDescriptor, "AsyncModule", builder );
+
+				std::cout << "Modules loaded from bundle: " << moduleManager.LoadModuleBundle( "logs/MapModule.bundle", &builder ) << std::endl;
+
+				auto pAsyncModule = build->Finish();
+
+				std::cout << "Async build finished: " << ( pAsyncModule ? "yes" : "no" ) << std::endl;
+
+				//The existing module is only replaced once the new one has been built.
+				auto replaceBuild = moduleManager.BuildModuleAsync( *pDescriptor, "AsyncModule", builder, nullptr, true );
+
+				replaceBuild->Wait();
+
+				std::cout << "Existing module kept while building: " << ( moduleManager.FindModuleByName( "AsyncModule" ) == pAsyncModule ? "yes" : "no" ) << std::endl;
+
+				auto pReplacement = replaceBuild->Finish();
+
+				std::cout << "Existing module replaced: " << ( pReplacement && moduleManager.FindModuleByName( "AsyncModule" ) == pReplacement ? "yes" : "no" ) << std::endl;
+
+				moduleManager.RemoveModule( "AsyncModule" );
+				moduleManager.RemoveModule( "MapModule" );
+			}
+
+			//Unchanged modules are loaded from the bytecode cache on the next build, and still go through PostBuild.
+			auto pCache = moduleManager.EnableBytecodeCache( "logs" );
+
+			if( auto pCachedModule = moduleManager.BuildModule( "MapScript", "CacheModule", builder ) )
+			{
+				moduleManager.RemoveModule( pCachedModule );
+
+				const auto uiHits = pCache->GetStats().uiHits;
+
+				pCachedModule = moduleManager.BuildModule( "MapScript", "CacheModule", builder );
+
+				std::cout << "Second build loaded from cache: " << ( pCache->GetStats().uiHits == uiHits + 1 ? "yes" : "no" ) << std::endl;
+
+				if( pCachedModule )
+				{
+					auto& scriptModule = *pCachedModule->GetModule();
+
+					const auto iIndex = scriptModule.GetGlobalVarIndexByName( "Scheduler" );
+
+					const bool bRanPostBuild = iIndex >= 0 &&
+						*reinterpret_cast<CASScheduler**>( scriptModule.GetAddressOfGlobalVar( iIndex ) ) == pCachedModule->GetScheduler();
+
+					std::cout << "PostBuild ran for cached module: " << ( bRanPostBuild ? "yes" : "no" ) << std::endl;
+					std::cout << "Cached module name kept: " << ( !strcmp( scriptModule.GetName(), "CacheModule" ) ? "yes" : "no" ) << std::endl;
+
+					moduleManager.RemoveModule( pCachedModule );
+				}
+			}
+
+			moduleManager.DisableBytecodeCache();
 		}
 	}
 